@@ -12,6 +12,8 @@ HEADERS += \
     ../Oln2/OutlineCtrl.h \
     ../Oln2/LinkSupport.h \
     ../Oln2/RefByItemMdl.h \
+    ../Oln2/RowLayoutWorker.h \
+    ../Oln2/OutlineItem.h \
     ../Oln2/OutlineUdbStream.h
 
 SOURCES += \
@@ -29,8 +31,12 @@ SOURCES += \
     ../Oln2/LinkSupport.cpp \
     ../Oln2/OutlineItem.cpp \
     ../Oln2/RefByItemMdl.cpp \
+    ../Oln2/RowLayoutWorker.cpp \
 	../Oln2/OutlineUdbStream.cpp
 
+# OutlineItem::updateAllRefs verwendet QtConcurrent
+greaterThan(QT_MAJOR_VERSION, 4): QT += concurrent
+
 HasLua {
 SOURCES += \
 	../Oln2/OlnLuaBinding.cpp
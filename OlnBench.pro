@@ -0,0 +1,21 @@
+# Benchmarks fuer OutlineMdl und OutlineTree (QtTest, ohne Datenbank).
+# Liegt wie die Anwendungen neben Stream, Udb, Txt und Gui2, damit die
+# relativen Pfade in deren .pri und in Oln2.pri aufgehen.
+
+QT += testlib
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+TARGET = OlnBench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+include(../Stream/Stream.pri)
+include(../Udb/Udb.pri)
+include(../Txt/Txt.pri)
+include(../Gui2/Gui2.pri)
+include(../Oln2/Oln2.pri)
+
+SOURCES += \
+    bench/OlnBench.cpp
@@ -145,17 +145,11 @@ struct _OutlineItem
 		bool includeAlias = false;
 		if( lua_gettop(L) > 1 )
 			includeAlias = lua_toboolean(L, 2);
-		QList<OutlineItem> refs = OutlineItem::getReferences( *obj );
-		if( includeAlias )
-		{
-			Udb::Idx idx( obj->getTxn(), OutlineItem::AliasIndex );
-			if( !idx.isNull() && idx.seek( *obj ) ) do
-			{
-				OutlineItem item = obj->getObject( idx.getOid() );
-				if( !refs.contains(item) )
-					refs.append(item);
-			}while( idx.nextKey() );
-		}
+		int max = -1; // optional: nur die ersten max Items
+		if( lua_gettop(L) > 2 && !lua_isnil(L, 3) )
+			max = lua_tointeger(L, 3);
+		ReferenceCursor c( *obj, includeAlias );
+		const QList<OutlineItem> refs = c.fetch( max );
 		lua_createtable(L, refs.size(), 0 );
 		const int table = lua_gettop(L);
 		for( int i = 0; i < refs.size(); i++ )
@@ -165,6 +159,16 @@ struct _OutlineItem
 		}
 		return 1;
 	}
+	static int countReferencingItems(lua_State *L)
+	{
+		ContentObject* obj = CoBin<ContentObject>::check( L, 1 );
+		bool includeAlias = false;
+		if( lua_gettop(L) > 1 )
+			includeAlias = lua_toboolean(L, 2);
+		ReferenceCursor c( *obj, includeAlias );
+		lua_pushinteger(L, c.count() );
+		return 1;
+	}
 };
 
 static const luaL_reg _OutlineItem_reg[] =
@@ -190,6 +194,7 @@ static const luaL_reg _ContentObject_reg[] =
 	{ "createOutlineItem", _OutlineItem::createItem },
 	{ "getOutlineItems", _OutlineItem::getItems },
 	{ "getReferencingItems", _OutlineItem::getReferencingItems },
+	{ "countReferencingItems", _OutlineItem::countReferencingItems },
 	{ 0, 0 }
 };
 
@@ -33,6 +33,9 @@
 #include <QKeySequence>
 #include <QtDebug>
 #include <QToolTip>
+#include <QTextDocumentFragment>
+#include <QFontDatabase>
+#include <qmath.h>
 #include <Txt/TextOutStream.h>
 #include <Txt/TextCursor.h>
 #include <Txt/TextHtmlImporter.h>
@@ -49,11 +52,23 @@ static const int s_wb = 1; // Change Bar Width
 static const int s_vo = -2; // -2, Vertical Offset of Text (nur fr den Text, nicht das Icon)
 static const int s_vhr = -1; // -1, Vertical Height Reduction (nur fr den Text, nicht das Icon)
 static const int s_pb = 1; // Pix Board
+static const int s_maxHeights = 100000; // Anzahl Eintrge im Hhen-Cache
+static const int s_rowCacheBudget = 32 * 1024 * 1024; // Bytes
+static const int s_maxRowHeight = 2048; // hhere Rows werden immer direkt gezeichnet
+static const int s_relayoutDelay = 100; // ms; sammelt Resultate des Workers fr ein doItemsLayout
+static const qreal s_docMargin = 4.0; // Default von QTextDocument::documentMargin
+static const int s_widthBucket = 32; // Pixel; Breitenklassen der Snapshot-Hhen
 
 OutlineDeleg::OutlineDeleg(OutlineTree *parent, Styles* s, const LinkRendererInterface *lr)
 	: QAbstractItemDelegate(parent), d_isTitle(false), d_isReadOnly( false ), d_biggerTitle( true ), 
-	  d_block1(false), d_showIcons( false ), d_linkRenderer( lr ), d_showIDs( true )
+	  d_block1(false), d_showIcons( false ), d_linkRenderer( lr ), d_showIDs( true ),
+	  d_rows( s_rowCacheBudget ), d_styleGen( 0 ), d_heightHits( 0 ), d_heightMisses( 0 ),
+	  d_worker( 0 ), d_queuedGen( 0 ), d_exactLayout( false ), d_seedGen( 0 )
 {
+	d_relayout.setSingleShot( true );
+	d_relayout.setInterval( s_relayoutDelay );
+	connect( &d_relayout, SIGNAL(timeout()), this, SLOT(onRelayout()) );
+
 	parent->viewport()->installEventFilter( this ); // wegen Focus und Resize whrend Edit
 	parent->installEventFilter( this ); // wegen Focus und Resize whrend Edit
 
@@ -94,6 +109,7 @@ void OutlineDeleg::onFontStyleChanged()
 	d_titleFont = Styles::inst()->getFont();
 	d_titleFont.setBold( true );
 	d_titleFont.setPointSizeF( d_titleFont.pointSizeF() * ( (d_biggerTitle)? 1.08 : 1.0 ) );
+	d_styleGen++; // alle gecachten Hhen sind ungltig
 	QFontMetrics m( d_ctrl->view()->getCursor().getStyles()->getFont() );
 	view()->setStepSize( m.height() );
 	view()->doItemsLayout();
@@ -104,6 +120,31 @@ OutlineTree* OutlineDeleg::view() const
 	return static_cast<OutlineTree*>( parent() ); 
 }
 
+static qreal _devicePixelRatio( const QPainter* p )
+{
+#if QT_VERSION >= 0x050000
+	return ( p->device() != 0 ) ? p->device()->devicePixelRatio() : 1.0;
+#else
+	Q_UNUSED( p );
+	return 1.0;
+#endif
+}
+
+static QColor _rowBackground( const QStyleOptionViewItem& option, const QColor& own, bool alternating )
+{
+	// Der Hintergrund, auf den die Row gemalt wird; ungltig, falls nicht einfarbig bekannt
+	if( !alternating )
+		return own;
+	if( option.state & QStyle::State_Selected )
+		return QColor(); // die Selektion malt QTreeView::drawRow darunter
+	const QStyleOptionViewItemV2* v2 = qstyleoption_cast<const QStyleOptionViewItemV2*>( &option );
+	const QBrush b = ( v2 != 0 && ( v2->features & QStyleOptionViewItemV2::Alternate ) ) ?
+				option.palette.alternateBase() : option.palette.base();
+	if( b.style() != Qt::SolidPattern )
+		return QColor();
+	return b.color();
+}
+
 static QString collectText( const TextHtmlParser& parser )
 {
 	QString text;
@@ -112,10 +153,63 @@ static QString collectText( const TextHtmlParser& parser )
 	return text;
 }
 
+quint32 OutlineDeleg::dependencyGen( const QModelIndex& index ) const
+{
+	const OutlineMdl* mdl = dynamic_cast<const OutlineMdl*>( index.model() );
+	return ( mdl != 0 ) ? mdl->getDependencyGen() : 0;
+}
+
+quint32 OutlineDeleg::dependencyGen( const OutlineMdl::RowData& rd )
+{
+	// Links zeigen Text, Nummer und Ident ihrer Ziele; Aliasse bekommen bei nderungen des Ziels
+	// vom Modell eine neue Revision
+	bool dependent = false;
+	if( rd.d_text.canConvert<Oln::OutlineMdl::Bml>() )
+		dependent = rd.d_text.value<Oln::OutlineMdl::Bml>().d_bml.contains( "link" );
+	else if( rd.d_text.canConvert<Oln::OutlineMdl::Html>() )
+		dependent = rd.d_text.value<Oln::OutlineMdl::Html>().d_html.contains(
+					QLatin1String( Styles::s_linkSchema ) );
+	return ( dependent ) ? rd.d_depGen : 0;
+}
+
+void OutlineDeleg::readRow( const QModelIndex & index, OutlineMdl::RowData& rd, int parts ) const
+{
+	if( ( parts & OutlineMdl::RowHead ) && d_showIcons )
+		parts |= OutlineMdl::RowDeco; // das Icon wird nur fr Aliasse gezeichnet
+	const OutlineMdl* mdl = dynamic_cast<const OutlineMdl*>( index.model() );
+	if( mdl != 0 && mdl->getRowData( index, rd, parts ) )
+		return;
+	// Andere Modelle ber die einzelnen Rollen
+	if( parts & OutlineMdl::RowHead )
+	{
+		rd.d_oid = index.data( OutlineMdl::OidRole ).toULongLong();
+		rd.d_rev = index.data( OutlineMdl::RevisionRole ).toUInt();
+		rd.d_level = index.data( OutlineMdl::LevelRole ).toInt();
+		rd.d_title = index.data( OutlineMdl::TitleRole ).toBool();
+		rd.d_alias = index.data( OutlineMdl::AliasRole ).toBool();
+		rd.d_readOnly = index.data( OutlineMdl::ReadOnlyRole ).toBool();
+		rd.d_ident = index.data( OutlineMdl::IdentRole ).toString();
+	}
+	if( ( parts & OutlineMdl::RowDeco ) && rd.d_alias )
+		rd.d_deco = index.data( Qt::DecorationRole ).value<QPixmap>();
+	if( parts & OutlineMdl::RowText )
+	{
+		rd.d_text = index.data( Qt::DisplayRole );
+		rd.d_plain = index.data( OutlineMdl::PlainTextRole ).toString();
+	}
+}
+
 OutlineDeleg::Format OutlineDeleg::renderToDocument( const QModelIndex & index, QTextDocument& doc ) const
 {
-	const bool isTitle = index.data( OutlineMdl::TitleRole ).toBool();
-	const QVariant v = index.data( Qt::DisplayRole );
+	OutlineMdl::RowData rd;
+	readRow( index, rd );
+	return renderToDocument( rd, doc );
+}
+
+OutlineDeleg::Format OutlineDeleg::renderToDocument( const OutlineMdl::RowData& rd, QTextDocument& doc ) const
+{
+	const bool isTitle = rd.d_title;
+	const QVariant& v = rd.d_text;
 	if( isTitle )
 	{
         //const int level = qMin( index.data( OutlineMdl::LevelRole ).toInt(), 6 );
@@ -126,7 +220,7 @@ OutlineDeleg::Format OutlineDeleg::renderToDocument( const QModelIndex & index,
 		QTextBlockFormat format = d_ctrl->view()->getCursor().getStyles()->getBlockFormat( Styles::PAR );
 		if( d_showIDs )
 		{
-			const QString id = index.data( OutlineMdl::IdentRole ).toString();
+			const QString& id = rd.d_ident;
 			if( !id.isEmpty() )
 			{
 				QFontMetricsF fm(d_titleFont);
@@ -134,7 +228,10 @@ OutlineDeleg::Format OutlineDeleg::renderToDocument( const QModelIndex & index,
 			}
 		}
 		cur.setBlockFormat( format );
-		if( v.canConvert<Oln::OutlineMdl::Html>() )
+		if( !rd.d_plain.isNull() )
+		{
+			cur.insertText( rd.d_plain, f ); // vom Modell gecacht, ohne Umweg ber ein Dokument
+		}else if( v.canConvert<Oln::OutlineMdl::Html>() )
 		{
 			TextHtmlParser parser;
 			parser.parse( v.value<Oln::OutlineMdl::Html>().d_html, 0 );
@@ -160,7 +257,7 @@ OutlineDeleg::Format OutlineDeleg::renderToDocument( const QModelIndex & index,
 		QTextBlockFormat format = d_ctrl->view()->getCursor().getStyles()->getBlockFormat( Styles::PAR );
 		if( d_showIDs )
 		{
-			const QString id = index.data( OutlineMdl::IdentRole ).toString();
+			const QString& id = rd.d_ident;
 			if( !id.isEmpty() )
 			{
 				QFont f = doc.defaultFont();
@@ -202,26 +299,28 @@ void OutlineDeleg::paint ( QPainter * painter, const QStyleOptionViewItem & opti
 {
 	painter->save();
 
+	OutlineMdl::RowData rd;
+	readRow( index, rd, OutlineMdl::RowHead ); // Text nur, falls die Row nicht im Cache ist
 	const bool isAlternatingColor = view()->alternatingRowColors();
 	QColor bgClr;
 	if( !isAlternatingColor )
 	{
-		if( index.data( OutlineMdl::AliasRole ).toBool() )
+		if( rd.d_alias )
 		{
 			bgClr = QColor::fromRgb( 245, 245, 245 ); // Grulich
-		}else if( index.data( OutlineMdl::TitleRole ).toBool() )
+		}else if( rd.d_title )
 		{
 			bgClr = QColor::fromRgb( 224, 249, 206 ); // Grnlich
 		}else
 		{
 			bgClr = QColor::fromRgb( 255, 254, 225 ); // Gelblich
 		}
-		const int level = index.data( OutlineMdl::LevelRole ).toInt();
+		const int level = rd.d_level;
 		bgClr = QColor::fromHsv( bgClr.hue(), bgClr.saturation(), bgClr.value() - ( level - 1 ) * 3 ); // TEST
 		painter->fillRect( option.rect, bgClr );
 	}
 
-	const QSize ds = decoSize( index );
+	const QSize ds = decoSize( rd );
 	QFont font;
 	if( d_edit == index )
 	{
@@ -231,17 +330,62 @@ void OutlineDeleg::paint ( QPainter * painter, const QStyleOptionViewItem & opti
 	}else
 	{
 		const QPoint off = QPoint( option.rect.left() + ds.width(), option.rect.top() + s_vo );
-		painter->translate( off );
-		QTextDocument doc;
-		renderToDocument( index, doc );
-		doc.setTextWidth( option.rect.width() - ds.width() - s_ro );
-		doc.drawContents( painter );
-		painter->translate( -off.x(), -off.y() );
-		font = doc.defaultFont();
+		const int width = option.rect.width() - ds.width() - s_ro;
+		const quint64 oid = rd.d_oid;
+		const quint32 rev = rd.d_rev;
+		// Das Pixmap wird mit dem Hintergrund gefllt, sonst fehlt das Subpixel-Antialiasing
+		const QColor bg = _rowBackground( option, bgClr, isAlternatingColor );
+		const qreal dpr = _devicePixelRatio( painter );
+		Row* row = ( oid != 0 && rev != 0 && bg.isValid() ) ? d_rows.object( oid ) : 0;
+		if( row != 0 && row->d_width == width && row->d_gen == d_styleGen && row->d_rev == rev &&
+			( row->d_depGen == 0 || row->d_depGen == rd.d_depGen ) &&
+			row->d_bg == bg.rgb() && row->d_dpr == dpr )
+		{
+			// Beim Scrollen nur noch kopieren
+			painter->drawPixmap( off, row->d_pix );
+			font = ( rd.d_title ) ? d_titleFont :
+				d_ctrl->view()->getCursor().getStyles()->getFont( 0 );
+		}else
+		{
+			readRow( index, rd, OutlineMdl::RowText );
+			QTextDocument doc;
+			renderToDocument( rd, doc );
+			doc.setTextWidth( width );
+			const QSize size = doc.size().toSize();
+			const QSize pixSize = size * dpr;
+			const int cost = pixSize.width() * pixSize.height() * 4;
+			if( oid != 0 && rev != 0 && bg.isValid() && size.height() <= s_maxRowHeight && !size.isEmpty() &&
+				cost <= d_rows.maxCost() / 8 )
+			{
+				row = new Row();
+				row->d_width = width;
+				row->d_gen = d_styleGen;
+				row->d_rev = rev;
+				row->d_depGen = dependencyGen( rd );
+				row->d_bg = bg.rgb();
+				row->d_dpr = dpr;
+				row->d_pix = QPixmap( pixSize );
+#if QT_VERSION >= 0x050000
+				row->d_pix.setDevicePixelRatio( dpr ); // sonst auf HiDPI unscharf
+#endif
+				row->d_pix.fill( bg );
+				QPainter p( &row->d_pix );
+				doc.drawContents( &p );
+				p.end();
+				painter->drawPixmap( off, row->d_pix );
+				d_rows.insert( oid, row, cost );
+			}else
+			{
+				painter->translate( off );
+				doc.drawContents( painter );
+				painter->translate( -off.x(), -off.y() );
+			}
+			font = doc.defaultFont();
+		}
 	}
 	if( d_showIDs )
 	{
-		const QString id = index.data( OutlineMdl::IdentRole ).toString();
+		const QString& id = rd.d_ident;
 		if( !id.isEmpty() )
 		{
 			font.setBold(true);
@@ -255,12 +399,8 @@ void OutlineDeleg::paint ( QPainter * painter, const QStyleOptionViewItem & opti
 		}
 	}
 	painter->setPen( Qt::lightGray );
-	if( d_showIcons && index.data( OutlineMdl::AliasRole ).toBool() )
-	{
-		QPixmap pix = index.data( Qt::DecorationRole ).value<QPixmap>();
-		if( !pix.isNull() )
-			painter->drawPixmap( option.rect.left() + s_lo + s_pb, option.rect.top() + s_pb, pix );
-	}
+	if( d_showIcons && rd.d_alias && !rd.d_deco.isNull() )
+		painter->drawPixmap( option.rect.left() + s_lo + s_pb, option.rect.top() + s_pb, rd.d_deco );
 	if( !isAlternatingColor )
 	{
         // Zeichne grauen Rahmen um den Textbereich
@@ -292,13 +432,200 @@ void OutlineDeleg::paint ( QPainter * painter, const QStyleOptionViewItem & opti
 	painter->restore();
 }
 
+void OutlineDeleg::setBackgroundLayout( bool on )
+{
+	if( on && !QFontDatabase::supportsThreadedFontRendering() )
+		on = false; // z.B. Qt4/X11: Fonts nur im GUI-Thread, also weiterhin synchron rechnen
+	if( on && d_worker == 0 )
+	{
+		d_worker = new RowLayoutWorker( this );
+		connect( d_worker, SIGNAL(sigResults()), this, SLOT(onLayoutResults()), Qt::QueuedConnection );
+	}else if( !on && d_worker != 0 )
+	{
+		delete d_worker; // wartet auf den Thread
+		d_worker = 0;
+		d_queued.clear();
+		QHash<quint64,Height>::iterator i = d_heights.begin();
+		while( i != d_heights.end() )
+		{
+			if( !i.value().d_exact )
+				i = d_heights.erase( i );
+			else
+				++i;
+		}
+		view()->doItemsLayout();
+	}
+}
+
+OutlineDeleg::SavedHeights OutlineDeleg::getExactHeights() const
+{
+	SavedHeights res;
+	QHash<quint64,Height>::const_iterator i;
+	for( i = d_heights.begin(); i != d_heights.end(); ++i )
+	{
+		if( i.value().d_exact && i.value().d_gen == d_styleGen )
+		{
+			SavedHeight h;
+			h.d_width = i.value().d_width;
+			h.d_size = i.value().d_size;
+			res.insert( i.key(), h );
+		}
+	}
+	return res;
+}
+
+int OutlineDeleg::widthBucket( int width )
+{
+	return width / s_widthBucket;
+}
+
+void OutlineDeleg::seedHeights( const SavedHeights& h )
+{
+	d_seeds = h;
+	d_seedGen = d_styleGen;
+}
+
+QString OutlineDeleg::getStyleKey() const
+{
+	return QString( "%1|%2|%3%4%5" ).arg( d_titleFont.toString() )
+		.arg( d_ctrl->view()->getCursor().getStyles()->getFont( 0 ).toString() )
+		.arg( d_showIcons ).arg( d_showIDs ).arg( d_biggerTitle );
+}
+
+bool OutlineDeleg::isEstimated( const QModelIndex& index ) const
+{
+	// Auch ohne Worker: Hhen aus dem Snapshot gelten nur als Schtzung
+	QHash<quint64,Height>::const_iterator i = d_heights.find( index.data( OutlineMdl::OidRole ).toULongLong() );
+	return i != d_heights.end() && !i.value().d_exact;
+}
+
+void OutlineDeleg::fillJob( const OutlineMdl::RowData& rd, int width, const QSize& ds, RowLayoutWorker::Job& j ) const
+{
+	// Schnappschuss aller Angaben, welche renderToDocument verwendet; nur Plaintext ist im Worker exakt
+	Styles* styles = d_ctrl->view()->getCursor().getStyles();
+	const bool isTitle = rd.d_title;
+	const QVariant& v = rd.d_text;
+	j.d_font = ( isTitle ) ? d_titleFont : styles->getFont( 0 );
+	j.d_indent = 0.0;
+	if( d_showIDs )
+	{
+		const QString& id = rd.d_ident;
+		if( !id.isEmpty() )
+		{
+			QFont f = j.d_font;
+			f.setBold( true );
+			j.d_indent = QFontMetricsF( f ).width( id ) + 2.0 * s_horiIdMargin;
+		}
+	}
+	// Der Worker rechnet nur mit Plaintext ohne Formate und Links; sein Resultat bleibt eine Schtzung,
+	// bis OutlineTree die Row sichtbar macht. Darum hier kein volles Parsen im GUI-Thread.
+	if( isTitle && !rd.d_plain.isNull() )
+		j.d_text = rd.d_plain;
+	else if( v.canConvert<Oln::OutlineMdl::Html>() )
+		j.d_text = TextOutHtml::htmlToPlainText( v.value<Oln::OutlineMdl::Html>().d_html );
+	else if( v.canConvert<Oln::OutlineMdl::Bml>() )
+	{
+		Stream::DataReader r( v.value<Oln::OutlineMdl::Bml>().d_bml );
+		j.d_text = r.extractString();
+	}else
+		j.d_text = v.toString();
+	const QTextBlockFormat format = styles->getBlockFormat( Styles::PAR );
+	j.d_width = width;
+	j.d_textWidth = width - ds.width() - s_ro - 2.0 * s_docMargin - format.leftMargin() - format.rightMargin();
+	j.d_extra = 2.0 * s_docMargin + format.topMargin() + format.bottomMargin() + s_vo + s_vhr;
+	j.d_minHeight = ds.height();
+}
+
+QSize OutlineDeleg::estimateSize( const OutlineMdl::RowData& rd, int width, const QSize& ds ) const
+{
+	const quint64 oid = rd.d_oid;
+	const quint32 rev = rd.d_rev;
+	if( d_queuedGen != d_styleGen )
+	{
+		// Jobs mit alten Fonts sind wertlos
+		d_worker->clear();
+		d_queued.clear();
+		d_queuedGen = d_styleGen;
+	}
+	RowLayoutWorker::Job j;
+	fillJob( rd, width, ds, j );
+	j.d_oid = oid;
+	j.d_rev = rev;
+	j.d_gen = d_styleGen;
+	j.d_depGen = dependencyGen( rd );
+
+	// Zeilen grob ber die mittlere Zeichenbreite abzhlen
+	const QFontMetricsF fm( j.d_font );
+	const qreal cw = qMax( fm.averageCharWidth(), qreal( 1.0 ) );
+	const int perLine = qMax( int( j.d_textWidth / cw ), 1 );
+	int lines = 0;
+	int indent = int( j.d_indent / cw );
+	foreach( const QString& par, j.d_text.split( QLatin1Char( '\n' ) ) )
+	{
+		lines += 1 + ( par.size() + indent ) / perLine;
+		indent = 0;
+	}
+	const QSize s( width - ds.width() - s_ro,
+		qMax( ds.height(), int( qCeil( lines * fm.lineSpacing() + j.d_extra ) ) ) );
+
+	if( d_heights.size() >= s_maxHeights )
+		d_heights.clear();
+	Height& h = d_heights[oid];
+	h.d_width = width;
+	h.d_gen = d_styleGen;
+	h.d_rev = rev;
+	h.d_size = s;
+	h.d_exact = false;
+	h.d_depGen = j.d_depGen;
+
+	QHash<quint64,Height>::const_iterator q = d_queued.find( oid );
+	if( q == d_queued.end() || q.value().d_width != width || q.value().d_rev != rev ||
+		q.value().d_depGen != h.d_depGen )
+	{
+		d_queued[oid] = h;
+		d_worker->post( j );
+	}
+	return s;
+}
+
+void OutlineDeleg::onLayoutResults()
+{
+	if( d_worker == 0 )
+		return;
+	const QList<RowLayoutWorker::Result> res = d_worker->takeResults();
+	bool changed = false;
+	foreach( const RowLayoutWorker::Result& r, res )
+	{
+		QHash<quint64,Height>::iterator q = d_queued.find( r.d_oid );
+		if( q != d_queued.end() && q.value().d_width == r.d_width && q.value().d_rev == r.d_rev &&
+			q.value().d_depGen == r.d_depGen )
+			d_queued.erase( q );
+		QHash<quint64,Height>::iterator i = d_heights.find( r.d_oid );
+		if( i == d_heights.end() || i.value().d_exact || i.value().d_width != r.d_width ||
+			i.value().d_gen != r.d_gen || i.value().d_rev != r.d_rev || i.value().d_depGen != r.d_depGen )
+			continue; // inzwischen exakt gerechnet oder veraltet
+		if( i.value().d_size.height() != r.d_size.height() )
+		{
+			i.value().d_size.setHeight( r.d_size.height() );
+			changed = true;
+		}
+	}
+	if( changed && !d_relayout.isActive() )
+		d_relayout.start();
+}
+
+void OutlineDeleg::onRelayout()
+{
+	view()->doItemsLayout();
+}
+
 QSize OutlineDeleg::sizeHint ( const QStyleOptionViewItem & option, 
 								 const QModelIndex & index ) const
 {
 	QSize s;
-	const QSize ds = decoSize( index );
 	if( d_edit == index )
 	{
+		const QSize ds = decoSize( index );
 		s = d_ctrl->view()->getExtent().toSize();
 		s.setHeight( qMax( ds.height(), s.height() + s_vo + s_vhr ) );
 		return s;
@@ -309,21 +636,85 @@ QSize OutlineDeleg::sizeHint ( const QStyleOptionViewItem & option,
 		return QSize(0,0); // Noch nicht bekannt.
 		// QSize() oder QSize(0,0) zeichnet gar nichts
 
+	const quint64 oid = index.data( OutlineMdl::OidRole ).toULongLong();
+	const quint32 rev = index.data( OutlineMdl::RevisionRole ).toUInt();
+	if( oid != 0 && rev != 0 )
+	{
+		QHash<quint64,Height>::const_iterator i = d_heights.find( oid );
+		if( i != d_heights.end() && i.value().d_width == width && i.value().d_gen == d_styleGen &&
+			i.value().d_rev == rev && ( i.value().d_exact || !d_exactLayout ) &&
+			( i.value().d_depGen == 0 || i.value().d_depGen == dependencyGen( index ) ) )
+		{
+			d_heightHits++;
+			return i.value().d_size;
+		}
+	}
+	d_heightMisses++;
+	if( !d_seeds.isEmpty() && oid != 0 && rev != 0 )
+	{
+		if( d_seedGen != d_styleGen )
+			d_seeds.clear();
+		else
+		{
+			// Hhe aus dem Snapshot der letzten Sitzung, gemessen in derselben Breitenklasse
+			SavedHeights::iterator j = d_seeds.find( oid );
+			while( j != d_seeds.end() && j.key() == oid && widthBucket( j.value().d_width ) != widthBucket( width ) )
+				++j;
+			if( j != d_seeds.end() && j.key() == oid )
+			{
+				if( d_heights.size() >= s_maxHeights )
+					d_heights.clear();
+				Height& h = d_heights[oid];
+				h.d_width = width;
+				h.d_gen = d_styleGen;
+				h.d_rev = rev;
+				h.d_size = j.value().d_size;
+				h.d_exact = false; // der Stempel erfasst z.B. Link-Labels nicht; OutlineTree misst sichtbare Rows nach
+				h.d_depGen = 0;
+				d_seeds.erase( j );
+				return h.d_size;
+			}
+		}
+	}
+	OutlineMdl::RowData rd;
+	readRow( index, rd );
+	const QSize ds = decoSize( rd );
+	if( d_worker != 0 && !d_exactLayout && oid != 0 && rev != 0 )
+		return estimateSize( rd, width, ds );
+
 	QTextDocument doc;
-	renderToDocument( index, doc );
+	renderToDocument( rd, doc );
 	doc.setTextWidth( width - ds.width() - s_ro );
 	s = doc.size().toSize();
 	s.setHeight( qMax( ds.height(), s.height() + s_vo + s_vhr ) ); 
+	if( oid != 0 && rev != 0 )
+	{
+		if( d_heights.size() >= s_maxHeights )
+			d_heights.clear(); // einfacher als LRU; die sichtbaren Rows sind schnell wieder drin
+		Height& h = d_heights[oid];
+		h.d_width = width;
+		h.d_gen = d_styleGen;
+		h.d_rev = rev;
+		h.d_size = s;
+		h.d_exact = true;
+		h.d_depGen = dependencyGen( rd );
+	}
 	return s;
 }
 
 QSize OutlineDeleg::decoSize( const QModelIndex & index ) const
 {
-	if( d_showIcons && index.data( OutlineMdl::AliasRole ).toBool() )
+	OutlineMdl::RowData rd;
+	readRow( index, rd, OutlineMdl::RowHead );
+	return decoSize( rd );
+}
+
+QSize OutlineDeleg::decoSize( const OutlineMdl::RowData& rd ) const
+{
+	if( d_showIcons && rd.d_alias && !rd.d_deco.isNull() )
 	{
-		QPixmap pix = index.data( Qt::DecorationRole ).value<QPixmap>();
-		if( !pix.isNull() )
-			return QSize( s_lo + s_pb + pix.width() + s_pb, pix.height() + 2 * s_pb + 1 ); // + 1 wegen unterer Trennlinie
+		const QPixmap& pix = rd.d_deco;
+		return QSize( s_lo + s_pb + pix.width() + s_pb, pix.height() + 2 * s_pb + 1 ); // + 1 wegen unterer Trennlinie
 	}
 	return QSize( s_lo, 0 );
 }
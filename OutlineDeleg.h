@@ -24,6 +24,12 @@
 #include <Txt/TextCtrl.h>
 #include <Txt/LinkRendererInterface.h>
 #include <QPersistentModelIndex>
+#include <QHash>
+#include <QCache>
+#include <QPixmap>
+#include <QTimer>
+#include "RowLayoutWorker.h"
+#include "OutlineMdl.h"
 
 class QTextDocument;
 
@@ -47,7 +53,7 @@ namespace Oln
 		bool isReadOnly() const;
 		void setReadOnly( bool );
 		void setBiggerTitle( bool );
-		void setShowIcons( bool on ) { d_showIcons = on; }
+		void setShowIcons( bool on ) { d_showIcons = on; d_styleGen++; }
 		QUrl getSelUrl() const; // returned URL is empty if not selected
         QByteArray getSelLink() const; // returned Link is empty if not selected
         void activateAnchor(); // Simuliert Click auf Anchor
@@ -61,8 +67,28 @@ namespace Oln
 
 		enum Format { Plain, Bml, Html };
 		Format renderToDocument( const QModelIndex & index, QTextDocument& doc ) const;
+		Format renderToDocument( const OutlineMdl::RowData&, QTextDocument& doc ) const;
+		void readRow( const QModelIndex & index, OutlineMdl::RowData&, int parts = OutlineMdl::RowAll ) const;
         const Txt::LinkRendererInterface* getLinkRenderer() const { return d_linkRenderer; }
 
+		// Statistik des Hhen-Caches von sizeHint
+		quint32 getHeightHits() const { return d_heightHits; }
+		quint32 getHeightMisses() const { return d_heightMisses; }
+		void clearHeightCache() { d_heights.clear(); d_heightHits = d_heightMisses = 0; }
+		void setRowCacheBudget( int bytes ) { d_rows.setMaxCost( bytes ); } // gerenderte Rows fr paint
+		// Hhen zuerst schtzen und im Hintergrund rechnen; sichtbare Rows macht OutlineTree exakt
+		void setBackgroundLayout( bool ); // aus, solange die Plattform keine Fonts in Threads erlaubt
+		bool isBackgroundLayout() const { return d_worker != 0; }
+		void setExactLayout( bool on ) const { d_exactLayout = on; } // sizeHint rechnet immer exakt
+		bool isEstimated( const QModelIndex& ) const; // gecachte Hhe ist nur geschtzt
+		// Fr den Layout-Snapshot von OutlineUdbCtrl
+		struct SavedHeight { int d_width; QSize d_size; };
+		typedef QMultiHash<quint64,SavedHeight> SavedHeights; // OID -> Hhen, je Breitenklasse eine
+		static int widthBucket( int width ); // Hhen derselben Klasse gelten freinander als Schtzung
+		SavedHeights getExactHeights() const;
+		void seedHeights( const SavedHeights& ); // werden bis zur nchsten Stilnderung statt Rendering verwendet
+		QString getStyleKey() const; // ndert sich mit allem, was die Hhen beeinflusst
+
 		//* Overrides von QAbstractItemDelegate
 		void paint(QPainter *painter, const QStyleOptionViewItem &option, 
 			const QModelIndex &index) const;
@@ -78,9 +104,16 @@ namespace Oln
 		void invalidate( const QRectF& );
 		void relayout();
 		void onFontStyleChanged();
+		void onLayoutResults();
+		void onRelayout();
 	protected:
 		void writeData( const QModelIndex & index ) const;
 		QSize decoSize( const QModelIndex & index ) const;
+		QSize decoSize( const OutlineMdl::RowData& ) const;
+		void fillJob( const OutlineMdl::RowData&, int width, const QSize& ds, RowLayoutWorker::Job& ) const;
+		QSize estimateSize( const OutlineMdl::RowData&, int width, const QSize& ds ) const;
+		quint32 dependencyGen( const QModelIndex& ) const;
+		static quint32 dependencyGen( const OutlineMdl::RowData& ); // fr den Cache-Eintrag
 	private:
 		QFont d_titleFont;
 		Txt::TextCtrl* d_ctrl;
@@ -93,6 +126,37 @@ namespace Oln
 		mutable quint8 d_editFormat;
 		mutable QPersistentModelIndex d_edit;
         const Txt::LinkRendererInterface* d_linkRenderer;
+		struct Height
+		{
+			int d_width; // Breite, fr die gerechnet wurde
+			quint32 d_gen; // d_styleGen
+			quint32 d_rev; // OutlineMdl::RevisionRole
+			QSize d_size;
+			bool d_exact; // false..geschtzt, Worker oder OutlineTree rechnen noch
+			quint32 d_depGen; // 0..Row hngt nur von sich selber ab, sonst OutlineMdl::getDependencyGen
+		};
+		mutable QHash<quint64,Height> d_heights; // OID -> Height
+		mutable QHash<quint64,Height> d_queued; // OID -> an d_worker bergeben
+		RowLayoutWorker* d_worker;
+		QTimer d_relayout;
+		mutable quint32 d_queuedGen;
+		mutable SavedHeights d_seeds;
+		quint32 d_seedGen;
+		mutable bool d_exactLayout;
+		struct Row
+		{
+			int d_width;
+			quint32 d_gen;
+			quint32 d_rev;
+			quint32 d_depGen; // wie Height::d_depGen
+			QRgb d_bg; // Hintergrund, mit dem d_pix gefllt ist
+			qreal d_dpr; // devicePixelRatio des Ziels
+			QPixmap d_pix;
+		};
+		mutable QCache<quint64,Row> d_rows; // OID -> gerenderter Text, Kosten in Bytes
+		quint32 d_styleGen;
+		mutable quint32 d_heightHits;
+		mutable quint32 d_heightMisses;
 	};
 }
 
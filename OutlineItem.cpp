@@ -22,10 +22,14 @@
 #include <Udb/Database.h>
 #include <Udb/Transaction.h>
 #include <Udb/Extent.h>
-#include <Txt/TextHtmlParser.h>
+#include <Udb/Idx.h>
+#include <Stream/DataWriter.h>
 #include <Txt/Styles.h>
 #include <Txt/TextOutStream.h>
 #include <QtDebug>
+#include <QCache>
+#include <QtConcurrentMap>
+#include <algorithm>
 using namespace Oln;
 using namespace Stream;
 
@@ -37,10 +41,13 @@ quint32 OutlineItem::AttrHome = 14;
 quint32 OutlineItem::AttrAlias = 15;
 quint32 Outline::TID = 11;
 quint32 Outline::AttrHasItems = 16;
+quint32 OutlineItem::AttrLinkDigest = 0;
+quint32 OutlineItem::AttrRefRebuildPos = 0;
 
 const char* OutlineItem::AliasIndex = "OutlineItem::AliasIndex";
 
 static bool s_doBackRef = false;
+static bool s_rebuildingRefs = false; // progress() darf keinen zweiten updateAllRefs starten
 
 OutlineItem OutlineItem::createItem(Udb::Obj &parent, const Udb::Obj &before)
 {
@@ -164,27 +171,83 @@ Udb::Obj OutlineItem::getNextItem() const
 	return Udb::Obj();
 }
 
-static int _itemNr( const Udb::Obj & item )
+static QHash<Udb::Database*,ItemOrdinals*> s_ordinals;
+static const int s_maxOrdinals = 200000;
+
+ItemOrdinals::ItemOrdinals(Udb::Database * db):d_levels( s_maxOrdinals ),d_db(db)
+{
+	db->addObserver( this, SLOT(onDbUpdate( Udb::UpdateInfo )), false );
+}
+
+int ItemOrdinals::itemNr( const Udb::Obj & item )
 {
-	Q_ASSERT( !item.getParent().isNull() );
+	const Udb::Obj parent = item.getParent();
+	Q_ASSERT( !parent.isNull() );
+	Udb::Database* db = item.getTxn()->getDb();
+	ItemOrdinals*& self = s_ordinals[ db ];
+	if( self == 0 )
+		self = new ItemOrdinals( db );
+	Level* l = self->d_levels.object( parent.getOid() );
+	if( l != 0 )
+	{
+		const QHash<Udb::OID,int>::const_iterator i = l->d_nr.find( item.getOid() );
+		if( i != l->d_nr.end() )
+			return i.value();
+	}
+	// Level einmal durchgehen und alle Positionen merken
+	if( self->d_parentOf.size() > s_maxOrdinals )
+	{
+		// Verdrngte Levels hinterlassen Eintrge; gelegentlich ganz neu beginnen
+		self->d_parentOf.clear();
+		self->d_levels.clear();
+	}
+	l = new Level();
 	int nr = 0;
-	Udb::Obj sub = item.getParent().getFirstObj();
-	do
+	Udb::Obj sub = parent.getFirstObj();
+	if( !sub.isNull() ) do
 	{
-		if( sub.equals( item ) )
-			return nr;
-		else if( sub.getType() == OutlineItem::TID )
-			nr++;
+		if( sub.getType() == OutlineItem::TID )
+		{
+			l->d_nr[ sub.getOid() ] = nr++;
+			self->d_parentOf[ sub.getOid() ] = parent.getOid();
+		}
 	}while( sub.next() );
-	Q_ASSERT( false );
-	return 0;
+	const int res = l->d_nr.value( item.getOid(), -1 );
+	Q_ASSERT( res >= 0 );
+	self->d_levels.insert( parent.getOid(), l, qMax( 1, l->d_nr.size() ) ); // lscht l, falls zu gross
+	return qMax( res, 0 );
+}
+
+void ItemOrdinals::onDbUpdate( Udb::UpdateInfo info )
+{
+	switch( info.d_kind )
+	{
+	case Udb::UpdateInfo::Aggregated:
+	case Udb::UpdateInfo::Deaggregated:
+		d_levels.remove( info.d_parent );
+		break;
+	case Udb::UpdateInfo::ObjectErased:
+		if( info.d_name == OutlineItem::TID )
+		{
+			const Udb::OID parent = d_parentOf.take( info.d_id );
+			if( parent != 0 )
+				d_levels.remove( parent );
+		}
+		break;
+	case Udb::UpdateInfo::DbClosing:
+		s_ordinals.remove( d_db );
+		deleteLater();
+		break;
+	default:
+		break;
+	}
 }
 
 QString OutlineItem::getParagraphNumber(const Udb::Obj & item)
 {
 	if( item.getType() == TID )
 	{
-		int nr = _itemNr( item );
+		int nr = ItemOrdinals::itemNr( item );
 		QString lhs = getParagraphNumber( item.getParent() );
 		if( !lhs.isEmpty() )
 			return lhs + QLatin1Char( '.' ) + QString::number( nr + 1 );
@@ -196,62 +259,143 @@ QString OutlineItem::getParagraphNumber(const Udb::Obj & item)
 
 static const QUuid s_backRefIdx = "{1c3f2ad8-99c1-11e5-8994-feff819cdc9f}";
 
-void OutlineItem::updateBackRefs(const OutlineItem & item, const DataCell & newText)
+static void _countLink( OutlineItem::LinkDigest& d, const QByteArray& data, const QUuid& dbid )
 {
-	if( !s_doBackRef )
-		return;
-	if( item.isNull() )
-		return;
-	const NameTag lt( "link" );
 	Link l;
-	const QUuid dbid = item.getDb()->getDbUuid();
-	const int slen = ::strlen( Txt::Styles::s_linkSchema );
-	QMap<Udb::OID,int> refs;
-	const DataCell oldText = item.getValue( AttrText );
-	if( oldText.isBml() )
+	if( l.readFrom( data ) && l.d_db == dbid )
+		d[l.d_oid]++;
+}
+
+OutlineItem::LinkDigest OutlineItem::extractLinks(const DataCell & text, const QUuid & dbid)
+{
+	LinkDigest res;
+	if( text.isBml() )
 	{
-		DataReader in( oldText );
+		const NameTag lt( "link" );
+		DataReader in( text );
 		while( DataReader::isUseful( in.nextToken() ) )
 		{
-			if( in.getName().getTag() == lt && l.readFrom( in.getValue().getArr() ) && l.d_db == dbid )
-				refs[l.d_oid]--;
+			if( in.getName().getTag() == lt )
+				_countLink( res, in.getValue().getArr(), dbid );
 		}
-	}else if( oldText.isHtml() )
+	}else if( text.isHtml() )
 	{
-		Txt::TextHtmlParser p;
-		p.parse( oldText.getStr(), 0 );
-		for( int i = 0; i < p.count(); i++ )
+		// Ein Durchgang ber die href-Attribute gengt; ein voller TextHtmlParser-Lauf ist hier zu teuer
+		const QString html = text.getStr();
+		const QString schema = QLatin1String( Txt::Styles::s_linkSchema );
+		const QLatin1String href( "href" );
+		int pos = 0;
+		while( ( pos = html.indexOf( href, pos, Qt::CaseInsensitive ) ) != -1 )
 		{
-			if( p.at(i).id == Txt::Html_a && p.at(i).charFormat.anchorHref().startsWith(QLatin1String(
-				Txt::Styles::s_linkSchema ) ) &&
-				l.readFrom( QByteArray::fromBase64( p.at(i).charFormat.anchorHref().mid( slen ).toAscii() ) ) &&
-							l.d_db == dbid )
-				refs[l.d_oid]--;
+			// Nur das Attribut selber, nicht etwa data-href oder Text mit "href"
+			const bool isAttr = pos > 0 && html[pos - 1].isSpace();
+			pos += 4;
+			if( !isAttr )
+				continue;
+			while( pos < html.size() && html[pos].isSpace() )
+				pos++;
+			if( pos >= html.size() || html[pos] != QLatin1Char('=') )
+				continue;
+			pos++;
+			while( pos < html.size() && html[pos].isSpace() )
+				pos++;
+			if( pos >= html.size() )
+				break;
+			const QChar quote = html[pos];
+			if( quote != QLatin1Char('"') && quote != QLatin1Char('\'') )
+				continue;
+			pos++;
+			const int end = html.indexOf( quote, pos );
+			if( end == -1 )
+				break;
+			if( end - pos > schema.size() && html.midRef( pos, schema.size() ) == schema )
+				_countLink( res, QByteArray::fromBase64(
+							   html.mid( pos + schema.size(), end - pos - schema.size() ).toAscii() ), dbid );
+			pos = end + 1;
 		}
 	}
-	if( newText.isBml() )
+	return res;
+}
+
+static quint32 _textStamp( const DataCell& text )
+{
+	// Erkennt Texte, die an updateBackRefs vorbei geschrieben wurden. Der Stempel liegt in der DB,
+	// darum CRC-32 (IEEE) statt qHash, das sich mit Qt-Version und Seed ndert.
+	DataWriter out;
+	out.writeSlot( text );
+	const QByteArray bytes = out.getStream();
+	quint32 crc = 0xffffffff;
+	for( int i = 0; i < bytes.size(); i++ )
 	{
-		DataReader in( newText );
-		while( DataReader::isUseful( in.nextToken() ) )
-		{
-			if( in.getName().getTag() == lt && l.readFrom( in.getValue().getArr() ) && l.d_db == dbid )
-				refs[l.d_oid]++;
-		}
-	}else if( newText.isHtml() )
+		crc ^= quint8( bytes[i] );
+		for( int b = 0; b < 8; b++ )
+			crc = ( crc >> 1 ) ^ ( 0xedb88320 & ( 0 - ( crc & 1 ) ) );
+	}
+	return ~crc;
+}
+
+static bool _readDigest( const OutlineItem& item, OutlineItem::LinkDigest& res, quint32* stamp = 0 )
+{
+	if( OutlineItem::AttrLinkDigest == 0 )
+		return false;
+	const DataCell v = item.getValue( OutlineItem::AttrLinkDigest );
+	if( !v.isBml() )
+		return false; // Items aus lteren Datenbanken haben noch keinen Digest
+	DataReader in( v );
+	if( !DataReader::isUseful( in.nextToken() ) )
+		return false;
+	if( stamp )
+		*stamp = in.getValue().getUInt32();
+	while( DataReader::isUseful( in.nextToken() ) )
 	{
-		Txt::TextHtmlParser p;
-		p.parse( newText.getStr(), 0 );
-		for( int i = 0; i < p.count(); i++ )
-		{
-			if( p.at(i).id == Txt::Html_a && p.at(i).charFormat.anchorHref().startsWith(QLatin1String(
-				Txt::Styles::s_linkSchema ) ) &&
-				l.readFrom( QByteArray::fromBase64( p.at(i).charFormat.anchorHref().mid( slen ).toAscii() ) ) &&
-							l.d_db == dbid )
-				refs[l.d_oid]++;
-		}
+		const Udb::OID oid = in.getValue().getOid();
+		if( !DataReader::isUseful( in.nextToken() ) )
+			break;
+		res[oid] = in.getValue().getUInt16();
 	}
-	if( refs.isEmpty() )
+	return true;
+}
+
+static OutlineItem::LinkDigest _indexedLinks( const OutlineItem& item )
+{
+	// Der Digest gibt den Stand des Index wieder, auch wenn der Text seither an updateBackRefs
+	// vorbei gendert wurde; ohne Digest gilt der gespeicherte Text
+	OutlineItem::LinkDigest res;
+	if( !_readDigest( item, res ) )
+		res = OutlineItem::extractLinks( item.getValue( OutlineItem::AttrText ), item.getDb()->getDbUuid() );
+	return res;
+}
+
+static void _writeDigest( OutlineItem item, const OutlineItem::LinkDigest& d, const DataCell& text )
+{
+	if( OutlineItem::AttrLinkDigest == 0 )
+		return;
+	DataWriter out;
+	out.writeSlot( DataCell().setUInt32( _textStamp( text ) ) );
+	OutlineItem::LinkDigest::const_iterator i;
+	for( i = d.begin(); i != d.end(); ++i )
+	{
+		out.writeSlot( DataCell().setOid( i.key() ) );
+		out.writeSlot( DataCell().setUInt16( i.value() ) );
+	}
+	// Unvernderte Digests nicht schreiben; jedes setValue meldet allen Observern ein ValueChanged
+	const DataCell old = item.getValue( OutlineItem::AttrLinkDigest );
+	if( old.isBml() && old.getBml() == out.getStream() )
 		return;
+	item.setValue( OutlineItem::AttrLinkDigest, out.getBml() );
+}
+
+static void _diffBackRefs( const OutlineItem & item, const OutlineItem::LinkDigest& oldD,
+						   const OutlineItem::LinkDigest& newD )
+{
+	if( oldD == newD )
+		return;
+	QMap<Udb::OID,int> refs;
+	OutlineItem::LinkDigest::const_iterator j;
+	for( j = oldD.begin(); j != oldD.end(); ++j )
+		refs[j.key()] -= j.value();
+	for( j = newD.begin(); j != newD.end(); ++j )
+		refs[j.key()] += j.value();
 	Udb::Obj idx = item.getTxn()->getOrCreateObject(s_backRefIdx);
 	Udb::Obj::KeyList k(2);
 	k[1] = item;
@@ -270,6 +414,19 @@ void OutlineItem::updateBackRefs(const OutlineItem & item, const DataCell & newT
 	}
 }
 
+void OutlineItem::updateBackRefs(const OutlineItem & item, const DataCell & newText)
+{
+	if( !s_doBackRef )
+		return;
+	if( item.isNull() )
+		return;
+	// Nur der neue Text wird gescannt; der alte Stand steht im Digest
+	const LinkDigest oldD = _indexedLinks( item );
+	const LinkDigest newD = extractLinks( newText, item.getDb()->getDbUuid() );
+	_diffBackRefs( item, oldD, newD );
+	_writeDigest( item, newD, newText ); // auch bei gleichen Links, wegen des Stempels; gleiche schreibt es nicht
+}
+
 void OutlineItem::updateBackRefs(const OutlineItem &item)
 {
 	if( !s_doBackRef )
@@ -277,93 +434,273 @@ void OutlineItem::updateBackRefs(const OutlineItem &item)
 	// dasselbe wie updateBackRefs(item,v), aber ohne neuen Wert, bzw. der bestehende wird eingetragen
 	if( item.isNull() )
 		return;
-	const NameTag lt( "link" );
-	Link l;
-	const QUuid dbid = item.getDb()->getDbUuid();
-	const int slen = ::strlen( Txt::Styles::s_linkSchema );
-	QMap<Udb::OID,int> refs;
 	const DataCell text = item.getValue( AttrText );
-	if( text.isBml() )
-	{
-		DataReader in( text );
-		while( DataReader::isUseful( in.nextToken() ) )
-		{
-			if( in.getName().getTag() == lt && l.readFrom( in.getValue().getArr() ) && l.d_db == dbid )
-				refs[l.d_oid]++;
-		}
-	}else if( text.isHtml() )
+	LinkDigest oldD;
+	quint32 stamp = 0;
+	const bool hasDigest = _readDigest( item, oldD, &stamp );
+	if( hasDigest && stamp == _textStamp( text ) )
+		return; // Index und Digest entsprechen bereits diesem Text
+	const LinkDigest refs = extractLinks( text, item.getDb()->getDbUuid() );
+	if( hasDigest )
 	{
-		Txt::TextHtmlParser p;
-		p.parse( text.getStr(), 0 );
-		for( int i = 0; i < p.count(); i++ )
-		{
-			if( p.at(i).id == Txt::Html_a && p.at(i).charFormat.anchorHref().startsWith(QLatin1String(
-				Txt::Styles::s_linkSchema ) ) &&
-				l.readFrom( QByteArray::fromBase64( p.at(i).charFormat.anchorHref().mid( slen ).toAscii() ) ) &&
-							l.d_db == dbid )
-				refs[l.d_oid]++;
-		}
+		// Der Text wurde an updateBackRefs vorbei geschrieben; der Digest kennt den Stand des Index
+		_diffBackRefs( item, oldD, refs );
+		_writeDigest( item, refs, text );
+		return;
 	}
+	_writeDigest( item, refs, text );
 	if( refs.isEmpty() )
 		return;
 	Udb::Obj idx = item.getTxn()->getOrCreateObject(s_backRefIdx);
 	Udb::Obj::KeyList k(2);
 	k[1] = item;
-	QMap<Udb::OID,int>::const_iterator i;
+	LinkDigest::const_iterator i;
 	for( i = refs.begin(); i != refs.end(); ++i )
 	{
-		if( i.value() != 0 )
-		{
-			k[0].setOid( i.key() );
-			idx.setCell(k, DataCell().setUInt16(i.value()) );
-			//qDebug() << "Indexed" << k[0].getOid() << k[1].getOid() << i.value(); // TEST
-		}
+		k[0].setOid( i.key() );
+		idx.setCell(k, DataCell().setUInt16(i.value()) );
+		//qDebug() << "Indexed" << k[0].getOid() << k[1].getOid() << i.value(); // TEST
 	}
 }
 
-void OutlineItem::updateAllRefs(Udb::Transaction* txn)
+struct _RefJob
 {
-	if( !s_doBackRef )
-		return;
-	Udb::Obj idx = txn->getOrCreateObject(s_backRefIdx);
-	idx.erase();
-	txn->commit();
+	Udb::OID d_oid;
+	DataCell d_text; // Kopie, damit die Worker die Transaction nicht anfassen
+};
+typedef QList<_RefJob> _RefChunk;
+
+struct _ExtractLinks
+{
+	typedef OutlineItem::LinkDigest result_type;
+	QUuid d_db;
+	_ExtractLinks( const QUuid& db ):d_db(db) {}
+	result_type operator()( const _RefJob& job ) const
+	{
+		return OutlineItem::extractLinks( job.d_text, d_db );
+	}
+};
+
+static const int s_refChunkSize = 4096; // Items pro Commit
+
+static QList<Udb::OID> _collectItems( Udb::Transaction* txn, Udb::OID resumeAfter )
+{
+	// Nur die OIDs; der Extent ist wieder zu, bevor der erste Chunk committed wird
+	QList<Udb::OID> res;
 	Udb::Extent e( txn );
+	Udb::OID last = 0;
 	if( e.first() ) do
 	{
-		OutlineItem obj = e.getObj();
-		if( obj.getType() == TID )
+		// Der Extent liefert die Objekte in aufsteigender OID-Reihenfolge; darauf baut resumeAfter
+		const Udb::Obj obj = e.getObj();
+		Q_ASSERT( obj.getOid() > last );
+		last = obj.getOid();
+		if( obj.getOid() > resumeAfter && obj.getType() == OutlineItem::TID )
+			res.append( obj.getOid() );
+	}while( e.next() );
+	return res;
+}
+
+static bool _readRefChunk( Udb::Transaction* txn, const QList<Udb::OID>& items, int& pos, _RefChunk& chunk )
+{
+	chunk.clear();
+	while( pos < items.size() && chunk.size() < s_refChunkSize )
+	{
+		const Udb::Obj obj = txn->getObject( items[pos++] );
+		if( obj.getType() != OutlineItem::TID )
+			continue; // seit dem Sammeln gelscht
+		_RefJob job;
+		job.d_oid = obj.getOid();
+		job.d_text = obj.getValue( OutlineItem::AttrText );
+		chunk.append( job );
+	}
+	return !chunk.isEmpty();
+}
+
+bool OutlineItem::isRebuildingRefs( Udb::Transaction* txn )
+{
+	if( s_rebuildingRefs )
+		return true;
+	if( AttrRefRebuildPos == 0 )
+		return false;
+	return txn->getOrCreateObject(s_backRefIdx).hasValue( AttrRefRebuildPos );
+}
+
+bool OutlineItem::updateAllRefs(Udb::Transaction* txn, RefRebuildProgress* progress )
+{
+	if( !s_doBackRef )
+		return true;
+	if( s_rebuildingRefs )
+		return false;
+	struct Guard
+	{
+		Guard() { s_rebuildingRefs = true; }
+		~Guard() { s_rebuildingRefs = false; }
+	} guard;
+	Udb::Obj idx = txn->getOrCreateObject(s_backRefIdx);
+	// Ohne AttrRefRebuildPos beginnt jeder Aufruf von vorne
+	const Udb::OID resumeAfter = ( AttrRefRebuildPos != 0 ) ? idx.getValue( AttrRefRebuildPos ).getOid() : 0;
+	if( resumeAfter == 0 )
+	{
+		idx.erase();
+		txn->commit();
+		idx = txn->getOrCreateObject(s_backRefIdx);
+	}
+	// Pipeline: der Hauptthread liest den nchsten Chunk, whrend der Pool den aktuellen auswertet;
+	// geschrieben wird wieder im Hauptthread, ein Commit pro Chunk.
+	const _ExtractLinks extract( txn->getDb()->getDbUuid() );
+	const QList<Udb::OID> items = _collectItems( txn, resumeAfter );
+	int pos = 0;
+	quint32 done = 0;
+	_RefChunk cur;
+	_readRefChunk( txn, items, pos, cur );
+	while( !cur.isEmpty() )
+	{
+		QFuture<LinkDigest> f = QtConcurrent::mapped( cur, extract );
+		_RefChunk next;
+		_readRefChunk( txn, items, pos, next );
+		f.waitForFinished();
+		Udb::Obj::KeyList k(2);
+		for( int i = 0; i < cur.size(); i++ )
 		{
-			updateBackRefs( obj );
+			OutlineItem item = txn->getObject( cur[i].d_oid );
+			const LinkDigest refs = f.resultAt( i );
+			_writeDigest( item, refs, cur[i].d_text );
+			k[1] = item;
+			LinkDigest::const_iterator j;
+			for( j = refs.begin(); j != refs.end(); ++j )
+			{
+				k[0].setOid( j.key() );
+				idx.setCell(k, DataCell().setUInt16(j.value()) );
+			}
 		}
-	}while( e.next() );
-	txn->commit();
+		done += cur.size();
+		if( AttrRefRebuildPos != 0 )
+		{
+			if( next.isEmpty() )
+				idx.clearValue( AttrRefRebuildPos );
+			else
+				idx.setValue( AttrRefRebuildPos, DataCell().setOid( cur.last().d_oid ) );
+		}
+		txn->commit();
+		if( !next.isEmpty() && progress != 0 && !progress->progress( done ) )
+			return false;
+		cur = next;
+	}
+	if( AttrRefRebuildPos != 0 && idx.hasValue( AttrRefRebuildPos ) )
+	{
+		// Nach dem Fortsetzungspunkt kam nichts mehr
+		idx.clearValue( AttrRefRebuildPos );
+		txn->commit();
+	}
+	if( progress )
+		progress->progress( done );
+	return true;
 }
 
 QList<OutlineItem> OutlineItem::getReferences(const Udb::Obj &obj)
+{
+	ReferenceCursor c( obj );
+	return c.fetch( -1 );
+}
+
+ReferenceCursor::ReferenceCursor(const Udb::Obj & target, bool includeAlias):
+	d_target( target ),d_pos(0),d_cur(0),d_phase(BackRefs),d_includeAlias(includeAlias)
+{
+	if( d_target.isNull() )
+		d_phase = Done;
+}
+
+ReferenceCursor::~ReferenceCursor()
+{
+}
+
+void ReferenceCursor::load()
+{
+	// Liest nur die Schlssel, ffnet keine Objekte; so bleibt kein Iterator ber einen Commit hinaus
+	// offen und jede Seite setzt dort fort, wo die letzte aufgehrt hat.
+	d_pending.clear();
+	d_pos = 0;
+	if( d_phase == BackRefs )
+	{
+		Udb::Obj idx = d_target.getTxn()->getOrCreateObject(s_backRefIdx);
+		Udb::Obj::KeyList k(1);
+		k[0] = d_target;
+		Udb::Mit refs = idx.findCells(k);
+		if( !refs.isNull() ) do
+		{
+			k = refs.getKey();
+			Q_ASSERT( k.size() == 2 );
+			d_pending.append( k[1].getOid() );
+			if( d_includeAlias )
+				d_seen.insert( k[1].getOid() );
+		}while( refs.nextKey() );
+		d_phase = ( d_includeAlias ) ? Aliases : Done;
+	}else if( d_phase == Aliases )
+	{
+		Udb::Idx aliases( d_target.getTxn(), OutlineItem::AliasIndex );
+		if( !aliases.isNull() && aliases.seek( d_target ) ) do
+		{
+			if( !d_seen.contains( aliases.getOid() ) )
+			{
+				d_seen.insert( aliases.getOid() );
+				d_pending.append( aliases.getOid() );
+			}
+		}while( aliases.nextKey() );
+		d_phase = Done;
+	}
+}
+
+bool ReferenceCursor::next()
+{
+	d_cur = 0;
+	while( d_pos >= d_pending.size() )
+	{
+		if( d_phase == Done )
+		{
+			d_pending.clear();
+			d_pos = 0;
+			return false;
+		}
+		load();
+	}
+	d_cur = d_pending[d_pos++];
+	return true;
+}
+
+OutlineItem ReferenceCursor::getItem() const
+{
+	if( d_cur == 0 )
+		return OutlineItem();
+	return d_target.getObject( d_cur );
+}
+
+QList<OutlineItem> ReferenceCursor::fetch(int max)
 {
 	QList<OutlineItem> res;
-	if( obj.isNull() )
-		return res;
-	Udb::Obj idx = obj.getTxn()->getOrCreateObject(s_backRefIdx);
-	Udb::Obj::KeyList k(1);
-	k[0] = obj;
-	Udb::Mit mit = idx.findCells(k);
-	if( !mit.isNull() ) do
-	{
-		k = mit.getKey();
-		Q_ASSERT( k.size() == 2 );
-		OutlineItem item = obj.getObject( k[1].getOid() );
-		if( item.getType() == TID )
+	while( ( max < 0 || res.size() < max ) && next() )
+	{
+		OutlineItem item = getItem();
+		if( item.getType() == OutlineItem::TID )
 			res.append( item );
 		else
-			qDebug() << "Invalid Reference in" << obj.getOid() << obj.getString( AttrText );
-		//qDebug() << "Found" << k[0].getOid() << k[1].getOid(); // TEST
-
-	}while( mit.nextKey() );
+			qDebug() << "Invalid Reference in" << d_cur << "to" << d_target.getOid();
+	}
 	return res;
 }
 
+quint32 ReferenceCursor::count()
+{
+	// Dieselbe Bedingung wie fetch, damit countReferencingItems zu getReferencingItems passt
+	quint32 n = 0;
+	while( next() )
+	{
+		if( getItem().getType() == OutlineItem::TID )
+			n++;
+	}
+	return n;
+}
+
 void OutlineItem::erase(Udb::Obj item)
 {
 	// NOTE: das ntzt nichts, da ja irgendwer ganze Objektbume lschen kann, wovon wir hier nichts erfahren.
@@ -375,15 +712,38 @@ void OutlineItem::itemErasedCallback(Udb::Transaction * txn, const Udb::UpdateIn
 {
 	if( info.d_kind != Udb::UpdateInfo::PreCommit )
 		return;
-	QList<Udb::UpdateInfo> updates = txn->getPendingNotifications();
+	const QList<Udb::UpdateInfo> updates = txn->getPendingNotifications();
+	QList< QPair<Udb::OID,Udb::OID> > erased; // (Ziel, gelschtes Item), wie die Index-Keys
 	for( int i = 0; i < updates.size(); i++ )
 	{
-		if( updates[i].d_kind == Udb::UpdateInfo::ObjectErased && updates[i].d_name == TID )
+		const Udb::UpdateInfo& u = updates[i];
+		if( s_doBackRef && u.d_kind == Udb::UpdateInfo::ObjectErased && u.d_name == TID )
 		{
-			OutlineItem item = txn->getObject( updates[i].d_id );
-			updateBackRefs( item, DataCell() );
+			// Der Digest gengt; der Text des gelschten Items wird nicht mehr gelesen
+			const OutlineItem item = txn->getObject( u.d_id );
+			if( item.isNull() )
+				continue;
+			const LinkDigest d = _indexedLinks( item );
+			LinkDigest::const_iterator j;
+			for( j = d.begin(); j != d.end(); ++j )
+				erased.append( qMakePair( j.key(), item.getOid() ) );
 		}
 	}
+	if( erased.isEmpty() )
+		return;
+	// Ein gelschtes Item referenziert nichts mehr; seine Zellen fallen unabhngig vom Zhler weg.
+	// Sortiert, damit der Index in Key-Reihenfolge durchlaufen wird.
+	std::sort( erased.begin(), erased.end() );
+	Udb::Obj idx = txn->getOrCreateObject(s_backRefIdx);
+	Udb::Obj::KeyList k(2);
+	for( int i = 0; i < erased.size(); i++ )
+	{
+		if( i > 0 && erased[i] == erased[i-1] )
+			continue;
+		k[0].setOid( erased[i].first );
+		k[1].setOid( erased[i].second );
+		idx.setCell( k, DataCell().setNull() );
+	}
 }
 
 void OutlineItem::doBackRef(bool on)
@@ -21,7 +21,12 @@
 */
 
 #include <Udb/ContentObject.h>
+#include <Udb/UpdateInfo.h>
+#include <QObject>
 #include <QVariant>
+#include <QMap>
+#include <QSet>
+#include <QCache>
 
 namespace Oln
 {
@@ -34,7 +39,11 @@ namespace Oln
 		static quint32 AttrIsReadOnly; // bool: ist Item ein Fixtext oder kann es bearbeitet werden
 		static quint32 AttrHome;       // OID: Referenz auf Root des Outlines von beliebigem Typ.
 		static quint32 AttrAlias;       // OID: optionale Referenz auf irgend ein Object, dessen Body statt des eigenen angezeigt wird.
+		// Die folgenden vergibt der Host; 0..nicht vergeben, dann ohne Digest bzw. ohne Fortsetzungspunkt
+		static quint32 AttrLinkDigest; // Bml: Stempel des Texts, dann sortierte (OID,Anzahl)-Paare der ausgehenden Links
+		static quint32 AttrRefRebuildPos; // OID: bis hierher hat ein abgebrochenes updateAllRefs den Index neu aufgebaut
 		static const char* AliasIndex;
+		typedef QMap<Udb::OID,quint16> LinkDigest; // Ziel -> Anzahl Links darauf
 
         OutlineItem(const Udb::Obj& o ):ContentObject(o){}
 		OutlineItem() {}
@@ -59,8 +68,19 @@ namespace Oln
 
 		static QString getParagraphNumber( const Udb::Obj& );
 		static void updateBackRefs( const OutlineItem& item, const Stream::DataCell& newText );
+		static LinkDigest extractLinks( const Stream::DataCell& text, const QUuid& db );
 		static void updateBackRefs( const OutlineItem& item );
-		static void updateAllRefs(Udb::Transaction *txn);
+		struct RefRebuildProgress
+		{
+			virtual bool progress( quint32 itemsDone ) = 0; // false..abbrechen
+			virtual ~RefRebuildProgress() {}
+		};
+		// false..abgebrochen oder schon im Gang; der naechste Aufruf setzt beim letzten Commit fort.
+		// Der Fortsetzungspunkt setzt voraus, dass Udb::Extent die Objekte nach aufsteigender OID liefert.
+		static bool updateAllRefs(Udb::Transaction *txn, RefRebuildProgress* = 0 );
+		// true, solange updateAllRefs laeuft oder ein abgebrochener Neuaufbau nicht fortgesetzt wurde;
+		// getReferences liefert dann nur einen Teil. Ohne AttrRefRebuildPos nur waehrend des Laufs erkennbar.
+		static bool isRebuildingRefs( Udb::Transaction* );
 		static QList<OutlineItem> getReferences( const Udb::Obj& obj ); // returns list of all outline items referencing obj
 		static void erase( Obj );
 		static void itemErasedCallback( Udb::Transaction*, const Udb::UpdateInfo& );
@@ -77,6 +97,55 @@ namespace Oln
 		static void markHasItems( Udb::Obj& );
 		static bool hasItems( const Udb::Obj& );
     };
+
+	// Positionen der Items unter ihrem Parent fuer getParagraphNumber, eine Instanz pro Datenbank;
+	// beobachtet die Datenbank selber und ist damit unabhaengig von offenen Views
+	class ItemOrdinals : public QObject
+	{
+		Q_OBJECT
+	public:
+		static int itemNr( const Udb::Obj& item );
+	protected slots:
+		void onDbUpdate( Udb::UpdateInfo );
+	private:
+		ItemOrdinals( Udb::Database* );
+		struct Level
+		{
+			QHash<Udb::OID,int> d_nr; // item -> Position unter den Items des Parents
+		};
+		// parent -> Level; Kosten sind die Anzahl Items, damit riesige Levels nicht alles verdraengen
+		QCache<Udb::OID,Level> d_levels;
+		QHash<Udb::OID,Udb::OID> d_parentOf; // item -> parent; ObjectErased nennt den Parent nicht mehr
+		Udb::Database* d_db;
+	};
+
+	// Geht die Items durch, die auf ein Objekt verweisen, ohne sie vorab alle zu oeffnen.
+	// Optional kommen die Aliasse aus dem AliasIndex dazu; jedes Item erscheint nur einmal.
+	// Pro Phase werden zuerst nur die OIDs aus dem Index gelesen; danach haelt der Cursor keine
+	// Iteratoren offen, zwischen zwei Aufrufen darf also committed werden.
+	class ReferenceCursor
+	{
+	public:
+		ReferenceCursor( const Udb::Obj& target, bool includeAlias = false );
+		~ReferenceCursor();
+		bool next(); // false..keine weiteren
+		bool atEnd() const { return d_phase == Done; }
+		Udb::OID getOid() const { return d_cur; }
+		OutlineItem getItem() const; // oeffnet das Objekt erst hier
+		QList<OutlineItem> fetch( int max ); // naechste Seite; max < 0..alle uebrigen
+		quint32 count(); // zaehlt die uebrigen, die fetch liefern wuerde
+	private:
+		Q_DISABLE_COPY( ReferenceCursor )
+		void load();
+		enum Phase { BackRefs, Aliases, Done };
+		Udb::Obj d_target;
+		QList<Udb::OID> d_pending; // OIDs der laufenden Phase in Indexreihenfolge
+		int d_pos; // naechster in d_pending
+		QSet<Udb::OID> d_seen; // Back-References; die Aliasse ueberspringen diese
+		Udb::OID d_cur;
+		Phase d_phase;
+		bool d_includeAlias;
+	};
 }
 
 #endif // OUTLINEITEM_H
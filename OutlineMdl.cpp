@@ -25,28 +25,28 @@
 #include <QStringList>
 #include <QMimeData>
 #include <cassert>
+#include <cstdlib>
+#include <algorithm>
 #include "OutlineStream.h"
 #include "TextToOutline.h"
 using namespace Oln;
 using namespace Udb;
 
 OutlineMdl::OutlineMdl(QObject *parent)
-	: QAbstractItemModel(parent), d_root(0)
+	: QAbstractItemModel(parent), d_root(0), d_numGen(1), d_revCounter(0), d_depGen(1), d_budget(0), d_slotBudget(0), d_epoch(1),
+	  d_touched(false)
 {
 }
 
 OutlineMdl::~OutlineMdl()
 {
 	if( d_root )
-		delete d_root;
+		destroySlot( d_root );
 }
 
 OutlineMdl::Slot::~Slot()
 {
-	for( int i = 0; i < d_subs.size(); i++ )
-	{
-		delete d_subs[i];
-	}
+	// Subs werden durch OutlineMdl::destroySlot freigegeben
 }
 
 int OutlineMdl::Slot::getLevel() const
@@ -57,6 +57,24 @@ int OutlineMdl::Slot::getLevel() const
 		return 0;
 }
 
+int OutlineMdl::Slot::getRow() const
+{
+	if( d_super == 0 )
+		return -1;
+	if( d_row < 0 || d_row >= d_super->d_subs.size() || d_super->d_subs[d_row] != this )
+		d_super->renumber();
+	Q_ASSERT( d_super->d_subs[d_row] == this );
+	return d_row;
+}
+
+void OutlineMdl::Slot::renumber() const
+{
+	// Nur ab der ersten vernderten Position neu durchnumerieren
+	for( int i = d_dirty; i < d_subs.size(); i++ )
+		d_subs[i]->d_row = i;
+	d_dirty = d_subs.size();
+}
+
 OutlineMdl::Slot* OutlineMdl::getSlot( const QModelIndex& index ) const
 {
 	Slot* s = 0;
@@ -112,20 +130,23 @@ QModelIndex OutlineMdl::parent(const QModelIndex & index) const
 		// else
 		Q_ASSERT( s->d_super != 0 );
 		Q_ASSERT( s->d_super->d_super != 0 );
-		return createIndex( s->d_super->d_super->d_subs.indexOf( s->d_super ), 0, s->d_super );
+		return createIndex( s->d_super->getRow(), 0, s->d_super );
 	}else
 		return QModelIndex();
 }
 
-static QString _number( const QModelIndex & index )
+const QString& OutlineMdl::getNumber( const Slot* s ) const
 {
-	if( !index.isValid() )
-		return QString();
-	QString lhs = _number( index.parent() );
-	if( !lhs.isEmpty() )
-		return lhs + QLatin1Char( '.' ) + QString::number( index.row() + 1 );
-	else
-		return QString::number( index.row() + 1 );
+	if( s->d_numGen != d_numGen )
+	{
+		// Die Nummer des Parents ist nach dem ersten Aufruf ebenfalls im Cache
+		if( s->d_super == d_root || s->d_super == 0 )
+			s->d_number = QString::number( s->getRow() + 1 );
+		else
+			s->d_number = getNumber( s->d_super ) + QLatin1Char( '.' ) + QString::number( s->getRow() + 1 );
+		s->d_numGen = d_numGen;
+	}
+	return s->d_number;
 }
 
 QVariant OutlineMdl::data ( const QModelIndex & index, int role ) const
@@ -153,7 +174,7 @@ QVariant OutlineMdl::data ( const QModelIndex & index, int role ) const
 	case TitleRole:
 		return s->isTitle(this);
 	case NumberRole:
-		return _number( index );
+		return getNumber( s );
 	case ExpandedRole:
 		return s->isExpanded(this);
 	case AliasRole:
@@ -168,10 +189,79 @@ QVariant OutlineMdl::data ( const QModelIndex & index, int role ) const
 	case Qt::WhatsThisRole:
 	case IdentRole:
 		return s->getData( this, role );
+	case RevisionRole:
+		return s->d_rev;
+	case PlainTextRole:
+		if( s->isAlias( this ) )
+			// Der Text kommt vom Ziel, dessen nderungen d_rev nicht erhhen; darum nicht cachen
+			return s->getData( this, PlainTextRole );
+		if( s->d_plainRev != s->d_rev )
+		{
+			s->d_plain = s->getData( this, PlainTextRole ).toString(); // null, falls das Slot keinen liefert
+			s->d_plainRev = s->d_rev;
+		}
+		if( s->d_plain.isNull() )
+			return QVariant();
+		else
+			return s->d_plain;
 	}
 	return QVariant();
 }
 
+bool OutlineMdl::getRowData( const QModelIndex & index, RowData& rd, int parts ) const
+{
+	if( d_root == 0 || !index.isValid() )
+		return false;
+    const Slot* s = static_cast<Slot*>( index.internalPointer() );
+    Q_ASSERT( s != 0 );
+	const bool isTitle = s->isTitle( this );
+	const bool isAlias = s->isAlias( this ); // d_plain eines Alias veraltet mit dem Ziel, siehe PlainTextRole
+	if( parts & RowHead )
+	{
+		rd.d_oid = s->getId();
+		rd.d_rev = s->d_rev;
+		rd.d_level = s->getLevel();
+		rd.d_title = isTitle;
+		rd.d_alias = isAlias;
+		rd.d_readOnly = isReadOnly() || s->isReadOnly( this );
+		rd.d_depGen = d_depGen;
+	}
+	rd.d_wantPlain = false;
+	if( parts & RowText )
+	{
+		rd.d_plain = QString();
+		if( isTitle && !isAlias && s->d_plainRev == s->d_rev )
+			rd.d_plain = s->d_plain;
+		else if( isTitle )
+			rd.d_wantPlain = true;
+	}
+	s->fillRowData( this, rd, parts );
+	if( rd.d_wantPlain )
+	{
+		if( !isAlias )
+		{
+			s->d_plain = rd.d_plain;
+			s->d_plainRev = s->d_rev;
+		}
+		rd.d_wantPlain = false;
+	}
+	return true;
+}
+
+void OutlineMdl::Slot::fillRowData(const OutlineMdl* mdl, RowData& rd, int parts ) const
+{
+	if( parts & RowHead )
+		rd.d_ident = getData( mdl, IdentRole ).toString();
+	if( ( parts & RowDeco ) && isAlias( mdl ) )
+		rd.d_deco = getData( mdl, Qt::DecorationRole ).value<QPixmap>();
+	if( parts & RowText )
+	{
+		rd.d_text = getData( mdl, Qt::DisplayRole );
+		if( rd.d_wantPlain )
+			rd.d_plain = getData( mdl, PlainTextRole ).toString();
+	}
+}
+
 QVariant OutlineMdl::headerData ( int section, Qt::Orientation orientation, int role ) const
 {
     Q_UNUSED(role);
@@ -204,25 +294,30 @@ void OutlineMdl::clear()
 		{
 			beginRemoveRows( QModelIndex(), 0, d_root->d_subs.size() - 1 );
 			d_cache.clear();
-			delete d_root;
+			destroySlot( d_root );
 			d_root = 0;
 			endRemoveRows();
 		}else
 		{
-			delete d_root;
+			destroySlot( d_root );
 			d_root = 0;
 		}
 	}
+	d_pool.release();
 	reset();
 }
 
-void OutlineMdl::recursiveRemove( Slot* s )
+void OutlineMdl::destroySlot( Slot* s )
 {
 	if( s == 0 )
 		return;
-	d_cache.remove( s->getId() );
+	// Post-Order: zuerst die Subs, dann der Slot selber; der Speicher geht zurck in den Pool
 	for( int i = 0; i < s->d_subs.size(); i++ )
-		recursiveRemove( s->d_subs[i] );
+		destroySlot( s->d_subs[i] );
+	if( s->d_super != 0 )
+		d_cache.remove( s->getId() );
+	s->~Slot();
+	d_pool.free( s );
 }
 
 void OutlineMdl::clearCache( const QModelIndex & parent )
@@ -234,11 +329,10 @@ void OutlineMdl::clearCache( const QModelIndex & parent )
 	// Lasse keine Listen mit gelschten Items rumliegen
 	QList<Slot*> tmp = s->d_subs;
 	s->d_subs.clear();
+	s->d_dirty = 0;
+	s->subsCleared();
 	for( int i = 0; i < tmp.size(); i++ )
-	{
-		recursiveRemove( tmp[i] );
-		delete tmp[i];
-	}
+		destroySlot( tmp[i] );
 	endRemoveRows();
 }
 
@@ -251,9 +345,7 @@ QModelIndex OutlineMdl::getIndex( quint64 oid, bool fetch ) const
 	if( s != 0 )
 	{
 		// Das Objekt wurde bereits geladen.
-		const int row = s->d_super->d_subs.indexOf( s );
-		assert( row >= 0 );
-		return createIndex( row, 0, s );
+		return createIndex( s->getRow(), 0, s );
 	}
 	return QModelIndex();
 }
@@ -278,12 +370,24 @@ void OutlineMdl::add( Slot* s, Slot* to, int before )
 	}else
 	{
 		assert( s->getId() != 0 );
-		d_cache[ s->getId() ] = s;
+		d_cache.insert( s->getId(), s );
+		bumpRevision( s ); // neue Slots haben nie eine bereits verwendete Revision
+		s->d_stamp = d_epoch; // frisch geladene Slots erst nach einer Runde ohne Anzeige verdrngen
 		s->d_super = to;
-		if( before < 0 )
+		if( before < 0 || before >= to->d_subs.size() )
+		{
+			// Append ndert keine bestehenden Nummern
+			s->d_row = to->d_subs.size();
+			if( to->d_dirty == s->d_row )
+				to->d_dirty++; // Append verschiebt niemanden
 			to->d_subs.append( s );
-		else
+		}else
+		{
 			to->d_subs.insert( before, s );
+			s->d_row = before;
+			d_numGen++;
+			to->d_dirty = qMin( to->d_dirty, before );
+		}
 	}
 }
 
@@ -294,17 +398,286 @@ void OutlineMdl::remove( Slot* s )
 		clear();
 	else
 	{
-		recursiveRemove( s );
-		s->d_super->d_subs.removeOne( s );
-		delete s;
+		Slot* super = s->d_super;
+		const int row = s->getRow();
+		super->d_subs.removeAt( row );
+		d_numGen++;
+		super->d_dirty = qMin( super->d_dirty, row );
+		destroySlot( s );
 	}
 }
 
+void OutlineMdl::move( Slot* from, int first, int last, Slot* to, int before )
+{
+	// Die Slots bleiben samt Subs erhalten; nur die Listen werden umgehngt
+	Q_ASSERT( from != 0 && to != 0 && first >= 0 && last < from->d_subs.size() && first <= last );
+	const QList<Slot*> l = from->d_subs.mid( first, last - first + 1 );
+	from->d_subs.erase( from->d_subs.begin() + first, from->d_subs.begin() + last + 1 );
+	from->d_dirty = qMin( from->d_dirty, first );
+	if( from == to && before > last )
+		before -= l.size();
+	for( int i = 0; i < l.size(); i++ )
+	{
+		l[i]->d_super = to;
+		to->d_subs.insert( before + i, l[i] );
+	}
+	to->d_dirty = qMin( to->d_dirty, before );
+	d_numGen++;
+}
+
 OutlineMdl::Slot* OutlineMdl::findSlot( quint64 id ) const
 {
 	return d_cache.value( id );
 }
 
+static inline quint32 _hash( quint64 id )
+{
+	// Finalizer von MurmurHash3; OIDs sind fortlaufend, darum gut durchmischen
+	id ^= id >> 33;
+	id *= Q_UINT64_C( 0xff51afd7ed558ccd );
+	id ^= id >> 33;
+	id *= Q_UINT64_C( 0xc4ceb9fe1a85ec53 );
+	id ^= id >> 33;
+	return quint32( id );
+}
+
+static const int s_minCap = 64;
+static const int s_slabSlots = 512; // Slots pro Slab
+
+OutlineMdl::Slot* OutlineMdl::SlotIndex::value( quint64 id ) const
+{
+	if( id == 0 || d_count == 0 )
+		return 0;
+	const int mask = d_table.size() - 1;
+	const Entry* t = d_table.constData();
+	int i = _hash( id ) & mask;
+	while( t[i].d_id != 0 )
+	{
+		if( t[i].d_id == id )
+			return t[i].d_slot;
+		i = ( i + 1 ) & mask;
+	}
+	return 0;
+}
+
+void OutlineMdl::SlotIndex::insert( quint64 id, Slot* s )
+{
+	Q_ASSERT( id != 0 );
+	// Maximale Belegung 70%, damit die Sondierketten kurz bleiben
+	if( ( d_count + 1 ) * 10 > d_table.size() * 7 )
+		rehash( qMax( s_minCap, d_table.size() * 2 ) );
+	const int mask = d_table.size() - 1;
+	Entry* t = d_table.data();
+	int i = _hash( id ) & mask;
+	while( t[i].d_id != 0 )
+	{
+		if( t[i].d_id == id )
+		{
+			t[i].d_slot = s;
+			return;
+		}
+		i = ( i + 1 ) & mask;
+	}
+	t[i].d_id = id;
+	t[i].d_slot = s;
+	d_count++;
+}
+
+void OutlineMdl::SlotIndex::remove( quint64 id )
+{
+	if( id == 0 || d_count == 0 )
+		return;
+	const int mask = d_table.size() - 1;
+	Entry* t = d_table.data();
+	int i = _hash( id ) & mask;
+	while( t[i].d_id != id )
+	{
+		if( t[i].d_id == 0 )
+			return; // nicht vorhanden
+		i = ( i + 1 ) & mask;
+	}
+	// Backward Shift statt Grabsteine: nachfolgende Eintrge der Kette nachrcken
+	int j = i;
+	while( true )
+	{
+		j = ( j + 1 ) & mask;
+		if( t[j].d_id == 0 )
+			break;
+		const int home = _hash( t[j].d_id ) & mask;
+		// Eintrag j darf nur nach i, wenn i zyklisch zwischen home und j liegt
+		if( ( ( j - home ) & mask ) >= ( ( j - i ) & mask ) )
+		{
+			t[i] = t[j];
+			i = j;
+		}
+	}
+	t[i] = Entry();
+	d_count--;
+	if( d_table.size() > s_minCap && d_count * 8 < d_table.size() )
+		rehash( d_table.size() / 2 );
+}
+
+void OutlineMdl::SlotIndex::clear()
+{
+	d_table = QVector<Entry>();
+	d_count = 0;
+}
+
+void OutlineMdl::SlotIndex::rehash( int cap )
+{
+	QVector<Entry> old = d_table;
+	d_table = QVector<Entry>( cap );
+	d_count = 0;
+	const Entry* t = old.constData();
+	for( int i = 0; i < old.size(); i++ )
+	{
+		if( t[i].d_id != 0 )
+			insert( t[i].d_id, t[i].d_slot );
+	}
+}
+
+void OutlineMdl::setSlotSize( int size )
+{
+	d_pool.setSlotSize( size );
+}
+
+OutlineMdl::PoolStats OutlineMdl::getPoolStats() const
+{
+	PoolStats res;
+	res.d_slabs = d_pool.getSlabCount();
+	res.d_slotSize = d_pool.getSlotSize();
+	res.d_capacity = res.d_slabs * s_slabSlots;
+	res.d_used = d_pool.getUsed();
+	res.d_bytes = qint64( res.d_capacity ) * res.d_slotSize;
+	return res;
+}
+
+bool OutlineMdl::isOverBudget() const
+{
+	return ( d_budget > 0 && qint64( d_pool.getUsed() ) * d_pool.getSlotSize() >= d_budget ) ||
+		( d_slotBudget > 0 && d_pool.getUsed() >= d_slotBudget );
+}
+
+void OutlineMdl::touch( const QModelIndex& index ) const
+{
+	if( !index.isValid() || index.model() != this )
+		return;
+	Slot* s = static_cast<Slot*>( index.internalPointer() );
+	s->d_stamp = d_epoch;
+	d_touched = true;
+}
+
+void OutlineMdl::setPinned( const QModelIndexList& l )
+{
+	d_pinned.clear();
+	foreach( const QModelIndex& index, l )
+	{
+		if( index.isValid() && index.model() == this )
+			d_pinned.insert( static_cast<Slot*>( index.internalPointer() )->getId() );
+	}
+}
+
+quint32 OutlineMdl::collectStale( Slot* s, quint32 limit, QList<Stale>& out ) const
+{
+	// Gibt die jngste Epoche im Subtree zurck; out enthlt nur maximale veraltete Subtrees
+	quint32 m = s->d_stamp;
+	if( s->d_super != 0 && d_pinned.contains( s->getId() ) )
+		m = 0xffffffff;
+	for( int i = 0; i < s->d_subs.size(); i++ )
+	{
+		Slot* sub = s->d_subs[i];
+		const int mark = out.size();
+		const quint32 sm = collectStale( sub, limit, out );
+		if( sm < limit && !sub->d_subs.isEmpty() )
+		{
+			out.erase( out.begin() + mark, out.end() );
+			Stale st;
+			st.d_stamp = sm;
+			st.d_slot = sub;
+			out.append( st );
+		}
+		m = qMax( m, sm );
+	}
+	return m;
+}
+
+int OutlineMdl::evict( int target )
+{
+	if( d_root == 0 || d_pool.getUsed() <= target )
+		return 0;
+	// Die Epoche schreitet nur fort, wenn seither gemalt wurde; so bleibt ein ruhender Viewport geschtzt
+	if( d_touched )
+	{
+		d_epoch++;
+		d_touched = false;
+	}
+	QList<Stale> l;
+	collectStale( d_root, d_epoch - 1, l );
+	std::sort( l.begin(), l.end() );
+	const int used = d_pool.getUsed();
+	for( int i = 0; i < l.size() && d_pool.getUsed() > target; i++ )
+		clearCache( createIndex( l[i].d_slot->getRow(), 0, l[i].d_slot ) );
+	return used - d_pool.getUsed();
+}
+
+OutlineMdl::SlotPool::SlotPool():d_free(0),d_size(0),d_used(0)
+{
+	setSlotSize( sizeof(Slot) );
+}
+
+void OutlineMdl::SlotPool::setSlotSize( int size )
+{
+	Q_ASSERT( d_slabs.isEmpty() );
+	// Auf 8 Bytes aufrunden, damit Pointer und quint64 im Slab korrekt ausgerichtet sind
+	d_size = ( qMax( size, int(sizeof(void*)) ) + 7 ) & ~7;
+}
+
+void* OutlineMdl::SlotPool::alloc()
+{
+	if( d_free == 0 )
+	{
+		char* slab = static_cast<char*>( ::malloc( d_size * s_slabSlots ) );
+		Q_CHECK_PTR( slab );
+		d_slabs.append( slab );
+		// Freiliste rckwrts aufbauen, damit die Slots in Adressreihenfolge vergeben werden
+		for( int i = s_slabSlots - 1; i >= 0; i-- )
+		{
+			void* p = slab + i * d_size;
+			*static_cast<void**>( p ) = d_free;
+			d_free = p;
+		}
+	}
+	void* p = d_free;
+	d_free = *static_cast<void**>( p );
+	d_used++;
+	return p;
+}
+
+void OutlineMdl::SlotPool::free( void* p )
+{
+	Q_ASSERT( p != 0 && d_used > 0 );
+	*static_cast<void**>( p ) = d_free;
+	d_free = p;
+	d_used--;
+}
+
+OutlineMdl::SlotPool::~SlotPool()
+{
+	// Lebende Slots wrden hier ihre Slabs behalten
+	Q_ASSERT( d_used == 0 );
+	release();
+}
+
+void OutlineMdl::SlotPool::release()
+{
+	if( d_used != 0 )
+		return;
+	for( int i = 0; i < d_slabs.size(); i++ )
+		::free( d_slabs[i] );
+	d_slabs.clear();
+	d_free = 0;
+}
+
 quint64 OutlineMdl::getId( const QModelIndex & i ) const
 {
 	Slot* s = getSlot( i );
@@ -25,6 +25,9 @@
 #include <QTextDocument>
 #include <QMap>
 #include <QSet>
+#include <QVector>
+#include <QPixmap>
+#include <new>
 
 namespace Oln
 {
@@ -39,12 +42,36 @@ namespace Oln
 			ExpandedRole,
 			ReadOnlyRole,
 			AliasRole,
-			IdentRole
+			IdentRole,
+			RevisionRole, // quint32, ndert sich bei jeder nderung der Darstellung eines Items
+			PlainTextRole // QString ohne Formate, pro Revision gecacht (ausser Aliasse); ungltig, falls nicht ohne Rendering mglich
 		};
 
 		struct Html { Html( const QString& html = QString() ):d_html(html){} QString d_html; };
 		struct Bml { Bml( const QByteArray& bml = QByteArray() ):d_bml(bml){} QByteArray d_bml; };
 
+		enum RowPart { RowHead = 1, RowText = 2, RowAll = 3,
+					   RowDeco = 4 }; // RowDeco: d_deco, nur fr Aliasse und nur wenn verlangt
+		struct RowData // alles, was der Delegate zum Zeichnen einer Row braucht, in einem Aufruf
+		{
+			// RowHead
+			quint64 d_oid;
+			quint32 d_rev;
+			int d_level;
+			bool d_title;
+			bool d_alias;
+			bool d_readOnly;
+			QString d_ident; // wie IdentRole
+			QPixmap d_deco; // wie Qt::DecorationRole; nur mit RowDeco
+			// RowText
+			QVariant d_text; // wie Qt::DisplayRole
+			QString d_plain; // wie PlainTextRole, nur fr Titel; sonst null
+			bool d_wantPlain; // intern: Slot soll d_plain aus d_text berechnen
+			quint32 d_depGen; // getDependencyGen beim Lesen; 0..nicht verfolgt
+			RowData():d_oid(0),d_rev(0),d_level(0),d_title(false),d_alias(false),d_readOnly(false),d_wantPlain(false),
+				d_depGen(0) {}
+		};
+
 		OutlineMdl(QObject *parent);
 		~OutlineMdl();
 
@@ -53,6 +80,29 @@ namespace Oln
 		void clearCache( const QModelIndex & parent ); // entferne alle Childs aus dem Arbeitsspeicher
 		QModelIndex getFirstIndex() const;
 		quint64 getId( const QModelIndex & ) const;
+		bool getRowData( const QModelIndex &, RowData&, int parts = RowAll ) const;
+		// ndert sich, wenn ein angezeigter Link veraltet (Text, Ident, Alias oder Position seines Ziels);
+		// ergnzt die Revision der Rows mit Links
+		quint32 getDependencyGen() const { return d_depGen; }
+
+		struct PoolStats // Speicherbelegung der Slots
+		{
+			int d_slabs;
+			int d_slotSize;
+			int d_capacity; // Anzahl Slots in allen Slabs
+			int d_used;
+			qint64 d_bytes;
+		};
+		PoolStats getPoolStats() const;
+		void setMemoryBudget( qint64 bytes ) { d_budget = bytes; } // 0..unbeschrnkt; gilt fr Vorausladen
+		qint64 getMemoryBudget() const { return d_budget; }
+		bool isOverBudget() const;
+		void setSlotBudget( int count ) { d_slotBudget = count; } // 0..unbeschrnkt; darber wird verdrngt
+		int getSlotBudget() const { return d_slotBudget; }
+		int getSlotCount() const { return d_pool.getUsed(); }
+		void touch( const QModelIndex& ) const; // vom View fr jede gemalte Row aufgerufen
+		void setPinned( const QModelIndexList& ); // diese Slots und ihre Parents werden nie verdrngt
+		int evict( int target ); // entfernt die am lngsten nicht gesehenen Subtrees bis target; gibt Anzahl Slots
 
 		// Interface
 		virtual bool isReadOnly() const { return false; } // identisch mit data( QModelIndex(), ReadOnlyRole );
@@ -72,14 +122,24 @@ namespace Oln
 		{
 			QList<Slot*> d_subs;
 			Slot* d_super;
+			mutable int d_row; // Position in d_super->d_subs, gilt nur unterhalb d_super->d_dirty
+			mutable int d_dirty; // ab dieser Position sind d_row der Subs veraltet
+			mutable QString d_number; // Cache fr NumberRole
+			mutable quint32 d_numGen; // gltig, solange gleich OutlineMdl::d_numGen
+			mutable quint32 d_stamp; // Epoche, in der der Slot zuletzt gemalt wurde
+			quint32 d_rev;
+			mutable quint32 d_plainRev; // d_plain gehrt zu dieser Revision
+			mutable QString d_plain;
 			friend class OutlineMdl;
+			void renumber() const;
 		protected:
 			virtual ~Slot();
 		public:
 			const QList<Slot*>& getSubs() const { return d_subs; }
 			Slot* getSuper() const { return d_super; }
 			int getLevel() const;
-			Slot():d_super(0) {}
+			int getRow() const;
+			Slot():d_super(0),d_row(-1),d_dirty(0),d_numGen(0),d_stamp(0),d_rev(0),d_plainRev(0) {}
 
 			virtual quint64 getId() const { return 0; }
 			virtual bool isTitle(const OutlineMdl*) const { return false; }
@@ -87,17 +147,78 @@ namespace Oln
 			virtual bool isReadOnly(const OutlineMdl*) const { return true; }
 			virtual bool isAlias(const OutlineMdl*) const { return false; }
             virtual QVariant getData(const OutlineMdl*,int) const { return QVariant(); }
+			virtual void subsCleared() {} // wird von clearCache aufgerufen
+			virtual void fillRowData(const OutlineMdl*, RowData&, int parts ) const; // ohne die Felder von Slot
 		};
 		Slot* getSlot( const QModelIndex& index ) const;
 		void add( Slot* s, Slot* to, int before = -1 );
 		void remove( Slot* );
+		void move( Slot* from, int first, int last, Slot* to, int before ); // wie beginMoveRows
+		void bumpRevision( Slot* s ) { s->d_rev = ++d_revCounter; }
+		void bumpDependencyGen() { d_depGen++; }
 		Slot* findSlot( quint64 id ) const;
 		Slot* getRoot() const { return d_root; }
+		void setSlotSize( int ); // vor dem ersten createSlot aufrufen, Grsse der grssten Slot-Subklasse
+		template<class T> T* createSlot()
+		{
+			Q_ASSERT( int(sizeof(T)) <= d_pool.getSlotSize() );
+			return new( d_pool.alloc() ) T();
+		}
+		void destroySlot( Slot* ); // inkl. aller Subs
 	private:
+		class SlotPool // Slab-Allokator mit Slots fester Grsse
+		{
+		public:
+			SlotPool();
+			~SlotPool();
+			void* alloc();
+			void free( void* );
+			void release(); // gibt alle Slabs frei, wenn kein Slot mehr lebt
+			void setSlotSize( int );
+			int getSlotSize() const { return d_size; }
+			int getSlabCount() const { return d_slabs.size(); }
+			int getUsed() const { return d_used; }
+		private:
+			QList<char*> d_slabs;
+			void* d_free; // Freiliste, verkettet ber den ersten Pointer im Slot
+			int d_size;
+			int d_used;
+		};
+		class SlotIndex // OID -> Slot; offene Adressierung mit linearem Sondieren
+		{
+		public:
+			SlotIndex():d_count(0) {}
+			Slot* value( quint64 id ) const;
+			void insert( quint64 id, Slot* );
+			void remove( quint64 id );
+			void clear();
+			int size() const { return d_count; }
+			int capacity() const { return d_table.size(); }
+		private:
+			struct Entry { quint64 d_id; Slot* d_slot; Entry():d_id(0),d_slot(0){} }; // d_id == 0 ist frei
+			QVector<Entry> d_table; // Groesse ist immer eine Zweierpotenz
+			int d_count;
+			void rehash( int cap );
+		};
 		Slot* d_root;
-		typedef QMap<quint32,Slot*> Cache;
-		Cache d_cache;
-		void recursiveRemove( Slot* s );
+		SlotIndex d_cache;
+		quint32 d_numGen; // wird bei jeder Verschiebung von Positionen erhht
+		quint32 d_revCounter;
+		quint32 d_depGen;
+		qint64 d_budget;
+		int d_slotBudget;
+		quint32 d_epoch;
+		mutable bool d_touched; // seit der letzten Verdrngung wurde gemalt
+		QSet<quint64> d_pinned; // aktuelles Item und Selektion
+		struct Stale
+		{
+			quint32 d_stamp;
+			Slot* d_slot;
+			bool operator<( const Stale& rhs ) const { return d_stamp < rhs.d_stamp; }
+		};
+		quint32 collectStale( Slot*, quint32 limit, QList<Stale>& ) const;
+		const QString& getNumber( const Slot* ) const;
+		SlotPool d_pool;
 	};
 }
 Q_DECLARE_METATYPE( Oln::OutlineMdl::Html ) 
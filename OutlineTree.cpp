@@ -99,7 +99,9 @@ public:
 
 OutlineTree::OutlineTree( QWidget* parent ):
 	QTreeView( parent), d_block( false ), d_stepSize(1), d_block2(false), d_showNumbers( true ),
-    d_handleWidth( 11 ), d_dragEnabled( true ), d_clickInEditor( false ), d_dragging(false)
+    d_handleWidth( 11 ), d_dragEnabled( true ), d_clickInEditor( false ), d_dragging(false),
+	d_viewRowsCount( 0 ), d_viewRowsValid( false ), d_estimated( false ), d_refining( false ),
+	d_measuredWidth( -1 )
 {
     setAttribute(Qt::WA_KeyCompression); // hat keinen erkennbaren Effekt, weder auf Linux noch Windows
     // setAttribute(Qt::WA_InputMethodEnabled); // wird bereits in QAbstractItemView gesetzt
@@ -126,6 +128,9 @@ OutlineTree::OutlineTree( QWidget* parent ):
 
 	connect( this, SIGNAL( expanded ( const QModelIndex & ) ), this, SLOT( onExpanded ( const QModelIndex & ) ) );
 	connect( this, SIGNAL( collapsed ( const QModelIndex & ) ), this, SLOT( onCollapsed ( const QModelIndex & ) ) );
+	d_expandTimer.setSingleShot( true );
+	d_expandTimer.setInterval( 0 );
+	connect( &d_expandTimer, SIGNAL(timeout()), this, SLOT(expandVisible()) );
 }
 
 OutlineTree::~OutlineTree()
@@ -203,6 +208,9 @@ void OutlineTree::drawRow( QPainter * painter, const QStyleOptionViewItem & opti
     // ein PE_FrameFocusRect um die Zeile, sobald currentRowHasFocus, egal welche Optionen noch gesetzt sind.
     // State_HasFocus oder State_KeyboardFocusChange haben keinen Einfluss, auch sonst keines der Flags
 	QTreeView::drawRow( painter, opt, index );
+	OutlineMdl* mdl = dynamic_cast<OutlineMdl*>( model() );
+	if( mdl )
+		mdl->touch( index ); // fr die Verdrngung nicht sichtbarer Subtrees
 
 	if( alternatingRowColors() && index == currentIndex() )
 	{
@@ -326,6 +334,8 @@ int OutlineTree::indexRowSizeHint(const QModelIndex &index) const
     Q_D(const QTreeView);
     if (!d->isIndexValid(index) || !d->itemDelegate)
         return 0;
+	if( d_estimated && !d_refining )
+		return estimateRowHeight( index ); // sichtbare Rows werden in refineVisible gemessen
 
     int start = -1;
     int end = -1;
@@ -397,44 +407,128 @@ int OutlineTree::indexRowSizeHint(const QModelIndex &index) const
     return height;
 }
 
+static inline bool isSameRow( const QModelIndex& a, const QModelIndex& b )
+{
+	return a.row() == b.row() && a.internalId() == b.internalId(); // ignore column
+}
+
+void OutlineTree::rebuildViewRows() const
+{
+	Q_D(const QTreeView);
+	d_viewRows.clear();
+	d_viewRows.reserve( d->viewItems.count() );
+	for( int i = 0; i < d->viewItems.count(); i++ )
+		d_viewRows.insert( d->viewItems.at(i).index.internalPointer(), i );
+	d_viewRowsCount = d->viewItems.count();
+	d_viewRowsValid = true;
+}
+
 int OutlineTree::viewIndex(const QModelIndex &index) const
 {
-	// TEST: analog zu QTreeViewPrivate::viewIndex, jedoch ohne firstVisibleItem
-	// Ergebnis: noch immer falsch gelayoutete Teile. Etwas langsamer als oben.
+	// Analog zu QTreeViewPrivate::viewIndex, jedoch ber einen Hash statt linearer Suche.
+	// Der Hash wird bei Layout-nderungen verworfen und beim nchsten Aufruf neu aufgebaut;
+	// jeder Treffer wird gegen viewItems geprft, ein veralteter oder fehlender Eintrag erzwingt
+	// einmal den Neuaufbau.
     Q_D(const QTreeView);
     if (!index.isValid() || d->viewItems.isEmpty())
         return -1;
 
     const int totalCount = d->viewItems.count();
-    const QModelIndex parent = index.parent();
-
-    // A quick check near the last item to see if we are just incrementing
-    const int start = lastViewedItem > 2 ? lastViewedItem - 2 : 0;
-    const int end = lastViewedItem < totalCount - 2 ? lastViewedItem + 2 : totalCount;
-    for (int i = start; i < end; ++i) {
-        const QModelIndex idx = d->viewItems.at(i).index;
-        if (idx.row() == index.row()) {
-            if (idx.internalId() == index.internalId() || idx.parent() == parent) {// ignore column
-                lastViewedItem = i;
-                return i;
-            }
-        }
-    }
-
-    // NOTE: this function is slow 
-    for (int i = 0; i < totalCount; ++i) {
-        const QModelIndex idx = d->viewItems.at(i).index;
-        if (idx.row() == index.row()) {
-            if (idx.internalId() == index.internalId() || idx.parent() == parent) {// ignore column
-                lastViewedItem = i;
-                return i;
-            }
-        }
-    }
+	bool rebuilt = false;
+	if( !d_viewRowsValid || d_viewRowsCount != totalCount )
+	{
+		rebuildViewRows();
+		rebuilt = true;
+	}
+	int i = d_viewRows.value( index.internalPointer(), -1 );
+	if( !rebuilt && ( i < 0 || i >= totalCount || !isSameRow( d->viewItems.at(i).index, index ) ) )
+	{
+		rebuildViewRows();
+		i = d_viewRows.value( index.internalPointer(), -1 );
+	}
+	if( i >= 0 && i < totalCount && isSameRow( d->viewItems.at(i).index, index ) )
+		return i;
     // nothing found
     return -1;
 }
 
+void OutlineTree::doItemsLayout()
+{
+	Q_D(QTreeView);
+	invalidateViewRows();
+	// Im Schtzmodus ndern sich beim Layout die Hhen oberhalb des Viewports; das oberste
+	// sichtbare Item soll trotzdem an seinem Platz bleiben
+	QPersistentModelIndex anchor;
+	int offset = 0;
+	if( d_estimated && d_measuredWidth != viewport()->width() )
+		resetAverages(); // die Hhen hngen von der Breite ab
+	if( d_estimated && !d->viewItems.isEmpty() )
+	{
+		const int first = d->itemAtCoordinate( 0 );
+		if( first >= 0 )
+		{
+			anchor = d->viewItems[first].index;
+			offset = d->coordinateForItem( first );
+		}
+	}
+	QTreeView::doItemsLayout();
+	if( anchor.isValid() )
+		anchorTo( anchor, offset );
+}
+
+void OutlineTree::anchorTo( const QModelIndex& anchor, int offset )
+{
+	Q_D(QTreeView);
+	const int i = viewIndex( anchor );
+	if( i < 0 )
+		return;
+	const int y = d->coordinateForItem( i );
+	if( y != offset )
+	{
+		// Nur die Position korrigieren; valueChanged wrde fetchVisible/fetchMore mitten im Layout auslsen
+		const bool blocked = verticalScrollBar()->blockSignals( true );
+		verticalScrollBar()->setValue( verticalScrollBar()->value() + y - offset );
+		verticalScrollBar()->blockSignals( blocked );
+		viewport()->update();
+	}
+}
+
+void OutlineTree::resetAverages()
+{
+	for( int i = 0; i < RowClassCount; i++ )
+		d_averages[i] = Average();
+	d_measured.clear();
+	d_measuredWidth = viewport()->width();
+}
+
+void OutlineTree::setEstimatedHeights( bool on )
+{
+	if( d_estimated == on )
+		return;
+	d_estimated = on;
+	resetAverages();
+	doItemsLayout();
+}
+
+OutlineTree::RowClass OutlineTree::rowClass( const QModelIndex& index )
+{
+	if( index.data( OutlineMdl::AliasRole ).toBool() )
+		return AliasRow;
+	else if( index.data( OutlineMdl::TitleRole ).toBool() )
+		return TitleRow;
+	else
+		return BodyRow;
+}
+
+int OutlineTree::estimateRowHeight( const QModelIndex& index ) const
+{
+	const Average& a = d_averages[rowClass( index )];
+	if( a.d_count > 0 )
+		return int( ( a.d_sum + a.d_count / 2 ) / a.d_count );
+	else
+		return fontMetrics().lineSpacing() + 4; // noch nichts gemessen
+}
+
 void OutlineTree::mousePressEvent(QMouseEvent *event)
 {
     Q_D(QTreeView);
@@ -577,7 +671,7 @@ void OutlineTree::ensureVisibleInCurrent( int yOffset, int h )
 	if( sb == 0 )
 		return;
     QRect area = d->viewport->rect();
-	const int item = d->viewIndex( currentIndex() );
+	const int item = viewIndex( currentIndex() );
 	const int y = d->coordinateForItem(item) + yOffset;
     const bool above = ( y < area.top() || area.height() < h );
     const bool below = ( y + h ) > area.bottom() && h < area.height();
@@ -603,23 +697,58 @@ void OutlineTree::currentChanged ( const QModelIndex & current, const QModelInde
 {
 	closeEdit();
 	QTreeView::currentChanged( current, previous );
+	updatePinned();
+}
+
+void OutlineTree::selectionChanged( const QItemSelection & selected, const QItemSelection & deselected )
+{
+	QTreeView::selectionChanged( selected, deselected );
+	updatePinned();
+}
+
+void OutlineTree::updatePinned()
+{
+	OutlineMdl* mdl = dynamic_cast<OutlineMdl*>( model() );
+	if( mdl == 0 )
+		return;
+	// Aktuelles Item und Selektion drfen nicht verdrngt werden, sonst geht die Selektion verloren
+	QModelIndexList l = selectionModel()->selectedIndexes();
+	l.append( currentIndex() );
+	mdl->setPinned( l );
 }
 
 void OutlineTree::setModel( QAbstractItemModel * model )
 {
+	if( this->model() )
+		disconnect( this->model(), 0, this, SLOT(onLayoutChanged()) );
 	QTreeView::setModel( model );
 	setSelectionModel( new OutlineTreeSelectionModel( model ) );
+	if( model )
+	{
+		// Verschiebungen und Umsortierungen ndern viewItems ohne rowsInserted/Removed
+		connect( model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(onLayoutChanged()) );
+		connect( model, SIGNAL(layoutChanged()), this, SLOT(onLayoutChanged()) );
+	}
+	d_pendingExpand.clear();
+	resetAverages();
 	restoreExpanded( QModelIndex() );
 }
 
+void OutlineTree::onLayoutChanged()
+{
+	invalidateViewRows();
+}
+
 void OutlineTree::onCollapsed ( const QModelIndex & index )
 {
+	invalidateViewRows();
 	if( !d_block2 )
 		model()->setData( index, false, OutlineMdl::ExpandedRole );
 }
 
 void OutlineTree::onExpanded ( const QModelIndex & index )
 {
+	invalidateViewRows();
 	if( !d_block2 )
 		model()->setData( index, true, OutlineMdl::ExpandedRole );
 	restoreExpanded( index );
@@ -627,34 +756,155 @@ void OutlineTree::onExpanded ( const QModelIndex & index )
 
 void OutlineTree::restoreExpanded( const QModelIndex &index, int start, int end )
 {
-	const bool block = d_block2;
-	d_block2 = true;
+	// expand() ldt die Subs und deren offene Subs wiederum ber rowsInserted; darum werden
+	// offene Items nur vorgemerkt und erst in expandVisible geffnet, sobald sie sichtbar sind.
 	const int max = qMax( model()->rowCount( index ) - 1, end );
 	for( int row = start; row <= max; row++ )
 	{
 		const QModelIndex i = model()->index( row, 0, index );
 		const bool exp = i.data( OutlineMdl::ExpandedRole ).toBool();
 		if( exp )
-			expand( i );
+			d_pendingExpand.insert( i.data( OutlineMdl::OidRole ).toULongLong() );
+	}
+	if( !d_pendingExpand.isEmpty() )
+		viewport()->update();
+}
+
+void OutlineTree::expandVisible()
+{
+	if( model() == 0 || d_pendingExpand.isEmpty() )
+		return;
+	QList<QPersistentModelIndex> toExpand;
+	QModelIndex i = indexAt( QPoint( 0, 0 ) );
+	const int h = viewport()->height();
+	while( i.isValid() && visualRect( i ).top() < h )
+	{
+		if( d_pendingExpand.remove( i.data( OutlineMdl::OidRole ).toULongLong() ) &&
+			i.data( OutlineMdl::ExpandedRole ).toBool() )
+			toExpand.append( i );
+		i = indexBelow( i );
+	}
+	const bool block = d_block2;
+	d_block2 = true;
+	foreach( const QPersistentModelIndex& index, toExpand )
+	{
+		if( index.isValid() )
+			expand( index );
 	}
 	d_block2 = block;
 }
 
 void OutlineTree::rowsInserted ( const QModelIndex & parent, int start, int end )
 {
+	invalidateViewRows();
 	QTreeView::rowsInserted( parent, start, end );
 	restoreExpanded( parent, start, end );
 }
 
+void OutlineTree::rowsAboutToBeRemoved ( const QModelIndex & parent, int start, int end )
+{
+	invalidateViewRows();
+	if( !d_pendingExpand.isEmpty() )
+		forgetExpanded( parent, start, end );
+	QTreeView::rowsAboutToBeRemoved( parent, start, end );
+}
+
+void OutlineTree::forgetExpanded( const QModelIndex &index, int start, int end )
+{
+	for( int row = start; row <= end; row++ )
+	{
+		const QModelIndex i = model()->index( row, 0, index );
+		d_pendingExpand.remove( i.data( OutlineMdl::OidRole ).toULongLong() );
+		const int count = model()->rowCount( i ); // ldt nicht nach
+		if( count > 0 )
+			forgetExpanded( i, 0, count - 1 );
+	}
+}
+
+void OutlineTree::reset()
+{
+	d_pendingExpand.clear();
+	invalidateViewRows();
+	QTreeView::reset();
+	if( model() )
+		restoreExpanded( QModelIndex() ); // wie in setModel
+}
+
 void OutlineTree::verticalScrollbarValueChanged(int value)
 {
 	QAbstractItemView::verticalScrollbarValueChanged( value );
-	return;
 	// NOTE: QAbstractItemView ruft canFetchMore nur mit parent=root auf. QTreeView nur in expand.
-	//QModelIndex i = indexAt( 
-    if( verticalScrollBar()->maximum() == value )
+	fetchVisible();
+}
+
+void OutlineTree::paintEvent( QPaintEvent * event )
+{
+	refineVisible();
+	QTreeView::paintEvent( event );
+	if( !d_pendingExpand.isEmpty() && !d_expandTimer.isActive() )
+		d_expandTimer.start(); // nicht whrend paintEvent das Layout ndern
+}
+
+void OutlineTree::refineVisible()
+{
+	Q_D(QTreeView);
+	OutlineDeleg* deleg = dynamic_cast<OutlineDeleg*>( itemDelegate() );
+	if( ( deleg == 0 && !d_estimated ) || d->viewItems.isEmpty() )
+		return;
+	const int first = d->itemAtCoordinate( 0 );
+	if( first < 0 )
+		return;
+	bool changed = false;
+	int y = d->coordinateForItem( first );
+	const int h = viewport()->height();
+	d_refining = true;
+	if( deleg )
+		deleg->setExactLayout( true );
+	for( int i = first; i < d->viewItems.size() && y < h; i++ )
+	{
+		const QModelIndex index = d->viewItems[i].index;
+		if( d_estimated || ( deleg && deleg->isEstimated( index ) ) )
+		{
+			// Im Schtzmodus wird jede sichtbare Row gemessen; bekannte Hhen kommen aus dem Cache des Delegate
+			const int height = indexRowSizeHint( index );
+			// Jede Row zhlt pro Breite nur einmal, sonst gewichten wiederholte Paints die sichtbaren Rows
+			if( d_estimated && !d_measured.contains( index.data( OutlineMdl::OidRole ).toULongLong() ) )
+			{
+				d_measured.insert( index.data( OutlineMdl::OidRole ).toULongLong() );
+				d_averages[rowClass( index )].add( height );
+			}
+			if( height != d->viewItems[i].height )
+			{
+				d->viewItems[i].height = height;
+				changed = true;
+			}
+		}
+		y += d->itemHeight( i );
+	}
+	if( deleg )
+		deleg->setExactLayout( false );
+	d_refining = false;
+	if( changed )
+		updateGeometries(); // Scrollbar an die neue Gesamthhe anpassen
+}
+
+void OutlineTree::fetchVisible()
+{
+	if( model() == 0 )
+		return;
+	// Jedes Level, dessen zuletzt geladenes Item im Viewport erscheint, wird nachgeladen, ebenso
+	// offene Items, deren Subs verdrngt wurden
+	QModelIndex i = indexAt( QPoint( 0, 0 ) );
+	const QModelIndex last = indexAt( QPoint( 0, viewport()->height() - 1 ) );
+	while( i.isValid() )
 	{
-		if( model()->canFetchMore( rootIndex() ) )
-			model()->fetchMore( rootIndex() );
+		const QModelIndex parent = i.parent();
+		if( i.row() == model()->rowCount( parent ) - 1 && model()->canFetchMore( parent ) )
+			model()->fetchMore( parent );
+		if( isExpanded( i ) && model()->rowCount( i ) == 0 && model()->canFetchMore( i ) )
+			model()->fetchMore( i );
+		if( i == last )
+			break;
+		i = indexBelow( i );
 	}
 }
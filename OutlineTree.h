@@ -21,6 +21,9 @@
 */
 
 #include <QTreeView>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
 
 namespace Oln
 {
@@ -39,15 +42,26 @@ namespace Oln
 		void goAndEdit( const QModelIndex& );
 		void closeEdit();
 		void setDragEnabled( bool on ) { d_dragEnabled = on; } // Verdeckt Methode der Oberklasse
+		// Nicht sichtbare Rows erhalten eine mittlere Hhe ihrer Art statt einer Anfrage an den Delegate
+		void setEstimatedHeights( bool );
+		bool isEstimatedHeights() const { return d_estimated; }
 		// Overrides
 		void setModel ( QAbstractItemModel * model );
+		void doItemsLayout();
+		void reset();
 	signals:
 		void returnPressed();
 		void identDoubleClicked();
 		void identClicked();
 	protected:
 		int viewIndex(const QModelIndex &index) const;
+		void invalidateViewRows() { d_viewRowsValid = false; }
 		void restoreExpanded( const QModelIndex &index, int start = 0, int end = -1 );
+		void forgetExpanded( const QModelIndex &index, int start, int end ); // inkl. geladener Subs
+		enum RowClass { BodyRow, TitleRow, AliasRow, RowClassCount };
+		static RowClass rowClass( const QModelIndex& );
+		int estimateRowHeight( const QModelIndex& ) const;
+		void anchorTo( const QModelIndex&, int offset ); // scrollt, bis das Item wieder bei offset liegt
 		bool startEdit(const QModelIndex &index, QEvent *event);
 		// Overrides
 		void keyPressEvent(QKeyEvent *event);
@@ -60,11 +74,19 @@ namespace Oln
 		void drawRow ( QPainter * painter, const QStyleOptionViewItem & option, const QModelIndex & index ) const;
 		void updateGeometries();
 		void currentChanged ( const QModelIndex & current, const QModelIndex & previous ) ;
+		void selectionChanged ( const QItemSelection & selected, const QItemSelection & deselected );
+		void updatePinned();
 		void rowsInserted ( const QModelIndex & parent, int start, int end );
+		void rowsAboutToBeRemoved ( const QModelIndex & parent, int start, int end );
 		void verticalScrollbarValueChanged( int );
+		void fetchVisible();
+		void refineVisible(); // ersetzt geschtzte Hhen der sichtbaren Rows durch exakte
+		void paintEvent( QPaintEvent * );
 	protected slots:
 		void onCollapsed ( const QModelIndex & index );
+		void onLayoutChanged();
 		void onExpanded ( const QModelIndex & index );
+		void expandVisible(); // ffnet die sichtbaren Items aus d_pendingExpand
 	private:
 		mutable bool d_block;
 		mutable bool d_block2;
@@ -76,7 +98,25 @@ namespace Oln
         bool d_dragging;
         bool d_hitExpander;
 		QPoint d_lastPressPoint;
-		mutable int lastViewedItem;
+		mutable QHash<void*,int> d_viewRows; // QModelIndex::internalPointer -> Position in viewItems
+		mutable int d_viewRowsCount; // Anzahl viewItems beim Aufbau von d_viewRows
+		mutable bool d_viewRowsValid;
+		bool d_estimated;
+		mutable bool d_refining; // indexRowSizeHint fragt den Delegate auch im Schtzmodus
+		struct Average
+		{
+			qint64 d_sum;
+			int d_count;
+			Average():d_sum(0),d_count(0) {}
+			void add( int h ) { d_sum += h; d_count++; }
+		};
+		Average d_averages[RowClassCount];
+		QSet<quint64> d_measured; // OIDs, die bereits in d_averages eingeflossen sind
+		int d_measuredWidth; // Viewport-Breite, fr welche d_averages gilt
+		void resetAverages();
+		QSet<quint64> d_pendingExpand; // OIDs mit ExpandedRole, die erst geffnet werden, wenn sie sichtbar sind
+		QTimer d_expandTimer;
+		void rebuildViewRows() const;
 		Q_DECLARE_PRIVATE(::QTreeView)
 	};
 }
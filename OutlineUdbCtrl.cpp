@@ -22,6 +22,8 @@
 #include "OutlineItem.h"
 #include "EditUrlDlg.h"
 #include <Udb/Database.h>
+#include <Stream/DataReader.h>
+#include <Stream/DataWriter.h>
 #include <Gui2/UiFunction.h>
 #include <Gui2/AutoShortcut.h>
 #include <Txt/TextOutStream.h>
@@ -35,6 +37,8 @@
 #include <QDesktopServices>
 #include <QFile>
 #include <QFileInfo>
+#include <QDir>
+#include <QSet>
 #include <cassert>
 #include <QtDebug>
 using namespace Oln;
@@ -43,6 +47,12 @@ using namespace Txt;
 
 Link OutlineUdbCtrl::s_itemDefault = Link( false, false, true, false, 50, true, true );
 Link OutlineUdbCtrl::s_objectDefault = Link( true, true, true, false, 0, false, true );
+static QString s_snapshotDir;
+static const quint8 s_snapshotVersion = 1;
+static const int s_snapshotBuckets = 3; // Breitenklassen pro Item
+
+static QHash<Udb::Transaction*,LinkCache*> s_linkCaches;
+static const int s_linkCacheSize = 5000;
 
 static void _expand( QTreeView* tv, OutlineUdbMdl* mdl, const QModelIndex& index, bool expand )
 {
@@ -69,7 +79,12 @@ OutlineUdbCtrl::OutlineUdbCtrl( OutlineTree* p, Udb::Transaction* txn ):
 	d_mdl = new OutlineUdbMdl( p );
 	d_txn->getDb()->addObserver( d_mdl, SLOT(onDbUpdate( Udb::UpdateInfo )), false );
 	setModel( d_mdl );
+	// Der Snapshot muss vor dem Reset des Modells geschrieben werden, auch wenn die DB schliesst
+	connect( d_mdl, SIGNAL(outlineAboutToChange()), this, SLOT(onOutlineAboutToChange()) );
+	// Die Hoehen der Rows mit Links gelten, bis ein aufgeloester Link veraltet
+	connect( LinkCache::get( d_txn ), SIGNAL(entriesDropped()), d_mdl, SLOT(onLinksChanged()) );
     d_txn->getDb()->addObserver( this, SLOT(onDbUpdate( Udb::UpdateInfo )), false );
+	p->installEventFilter( this ); // Snapshot auch beim Schliessen des Fensters
 	// Nein connect( p, SIGNAL( returnPressed() ), this, SLOT( onAddNextImp() ) );
 
     connect( d_deleg->getEditCtrl(), SIGNAL(anchorActivated(QByteArray,bool)),
@@ -77,6 +92,12 @@ OutlineUdbCtrl::OutlineUdbCtrl( OutlineTree* p, Udb::Transaction* txn ):
 
 }
 
+OutlineUdbCtrl::~OutlineUdbCtrl()
+{
+	// Das Modell ist ebenfalls Kind des Trees, wird aber erst nach dem Controller gelöscht
+	d_mdl->flushExpanded();
+}
+
 OutlineUdbCtrl* OutlineUdbCtrl::create( QWidget* p, Udb::Transaction* txn )
 {
 	OutlineTree* tree = new OutlineTree( p );
@@ -138,8 +159,8 @@ void OutlineUdbCtrl::setOutline( const Udb::Obj& o, bool setCurrent )
 {
 	if( d_deleg->isEditing() )
 		d_deleg->closeEdit();
-	d_mdl->setOutline( o );
-	if( setCurrent )
+	d_mdl->setOutline( o ); // onOutlineAboutToChange sichert den alten Snapshot
+	if( !loadSnapshot( setCurrent ) && setCurrent )
 	{
 		d_mdl->fetchLevel( QModelIndex() );
 		if( d_mdl->rowCount() )
@@ -147,6 +168,201 @@ void OutlineUdbCtrl::setOutline( const Udb::Obj& o, bool setCurrent )
 	}
 }
 
+void OutlineUdbCtrl::setSnapshotDir( const QString& path )
+{
+	s_snapshotDir = path;
+	if( !path.isEmpty() )
+		QDir().mkpath( path );
+}
+
+QString OutlineUdbCtrl::getSnapshotDir()
+{
+	return s_snapshotDir;
+}
+
+QString OutlineUdbCtrl::getSnapshotPath() const
+{
+	const Udb::Obj& oln = d_mdl->getOutline();
+	if( s_snapshotDir.isEmpty() || oln.isNull() )
+		return QString();
+	return QDir( s_snapshotDir ).absoluteFilePath( QString( "%1-%2.olnl" )
+		.arg( d_txn->getDb()->getDbUuid().toString().mid( 1, 36 ) ).arg( oln.getOid() ) );
+}
+
+static QString _layoutStamp( const Udb::Obj& item )
+{
+	// Alles, was die Höhe einer Row ändert, ohne dass sich die Breite ändert
+	QString stamp = QString( "%1|%2|%3" ).arg( item.getValue( OutlineItem::AttrModifiedOn ).getDateTime().toMSecsSinceEpoch() )
+		.arg( item.getValue( OutlineItem::AttrIsTitle ).getBool() ).arg( OutlineItem( item ).getAltOrIdent() );
+	const Udb::Obj alias = item.getValueAsObj( OutlineItem::AttrAlias );
+	if( !alias.isNull() )
+		stamp += QString( "|%1" ).arg( alias.getValue( OutlineItem::AttrModifiedOn ).getDateTime().toMSecsSinceEpoch() );
+	return stamp;
+}
+
+void OutlineUdbCtrl::saveSnapshot() const
+{
+	const QString path = getSnapshotPath();
+	if( path.isEmpty() )
+		return;
+	const Udb::OID home = d_mdl->getOutline().getOid();
+	DataWriter out;
+	out.startFrame( NameTag( "olnl" ) );
+	out.writeSlot( DataCell().setUInt8( s_snapshotVersion ), NameTag( "ver" ) );
+	out.writeSlot( DataCell().setString( d_deleg->getStyleKey() ), NameTag( "styl" ) );
+	const QModelIndex top = getTree()->indexAt( QPoint( 0, 0 ) );
+	if( top.isValid() )
+		out.writeSlot( DataCell().setOid( d_mdl->getItem( top ).getOid() ), NameTag( "top" ) );
+	const QModelIndex cur = getTree()->currentIndex();
+	if( cur.isValid() )
+		out.writeSlot( DataCell().setOid( d_mdl->getItem( cur ).getOid() ), NameTag( "cur" ) );
+	// Die aktuellen Höhen zuerst, dann die anderer Breitenklassen aus dem geladenen Snapshot
+	const OutlineDeleg::SavedHeights heights = d_deleg->getExactHeights();
+	QList<quint64> oids = heights.uniqueKeys();
+	foreach( quint64 oid, d_snapHeights.uniqueKeys() )
+		if( !heights.contains( oid ) )
+			oids.append( oid );
+	foreach( quint64 oid, oids )
+	{
+		// Der Delegate kennt auch Items anderer Outlines
+		const Udb::Obj item = d_txn->getObject( oid );
+		if( item.isNull() || item.getType() != OutlineItem::TID ||
+			item.getValue( OutlineItem::AttrHome ).getOid() != home )
+			continue;
+		const QString stamp = _layoutStamp( item );
+		QList<OutlineDeleg::SavedHeight> hs = heights.values( oid );
+		if( d_snapStamps.value( oid ) == stamp )
+			hs += d_snapHeights.values( oid ); // seit dem Laden unverändert
+		QSet<int> buckets;
+		foreach( const OutlineDeleg::SavedHeight& h, hs )
+		{
+			const int bucket = OutlineDeleg::widthBucket( h.d_width );
+			if( buckets.contains( bucket ) || buckets.size() >= s_snapshotBuckets )
+				continue;
+			buckets.insert( bucket );
+			out.startFrame( NameTag( "h" ) );
+			out.writeSlot( DataCell().setOid( oid ), NameTag( "oid" ) );
+			out.writeSlot( DataCell().setString( stamp ), NameTag( "ts" ) );
+			out.writeSlot( DataCell().setInt32( h.d_width ), NameTag( "w" ) );
+			out.writeSlot( DataCell().setInt32( h.d_size.width() ), NameTag( "sw" ) );
+			out.writeSlot( DataCell().setInt32( h.d_size.height() ), NameTag( "sh" ) );
+			out.endFrame();
+		}
+	}
+	out.endFrame();
+	QFile f( path );
+	if( f.open( QIODevice::WriteOnly ) )
+		f.write( out.getStream() );
+}
+
+void OutlineUdbCtrl::onOutlineAboutToChange()
+{
+	saveSnapshot();
+	d_snapHeights.clear();
+	d_snapStamps.clear();
+}
+
+bool OutlineUdbCtrl::eventFilter( QObject* watched, QEvent* e )
+{
+	// Hide kommt auch, wenn das Fenster geschlossen oder gelöscht wird, solange der Tree noch ganz ist;
+	// im Destruktor des Controllers ist er das nicht mehr
+	if( watched == getTree() && e->type() == QEvent::Hide )
+		saveSnapshot();
+	return OutlineCtrl::eventFilter( watched, e );
+}
+
+bool OutlineUdbCtrl::loadSnapshot( bool setCurrent )
+{
+	const QString path = getSnapshotPath();
+	if( path.isEmpty() )
+		return false;
+	QFile f( path );
+	if( !f.open( QIODevice::ReadOnly ) )
+		return false;
+	DataReader in( f.readAll() );
+	DataReader::Token t = in.nextToken();
+	if( t != DataReader::BeginFrame || !in.getName().getTag().equals( "olnl" ) )
+		return false;
+	OutlineDeleg::SavedHeights heights;
+	Udb::OID top = 0;
+	Udb::OID cur = 0;
+	bool sameStyle = false;
+	t = in.nextToken();
+	while( DataReader::isUseful( t ) )
+	{
+		if( t == DataReader::Slot )
+		{
+			const NameTag name = in.getName().getTag();
+			if( name.equals( "ver" ) )
+			{
+				if( in.getValue().getUInt8() != s_snapshotVersion )
+					return false;
+			}else if( name.equals( "styl" ) )
+				sameStyle = in.getValue().toString() == d_deleg->getStyleKey();
+			else if( name.equals( "top" ) )
+				top = in.getValue().getOid();
+			else if( name.equals( "cur" ) )
+				cur = in.getValue().getOid();
+		}else if( t == DataReader::BeginFrame && in.getName().getTag().equals( "h" ) )
+		{
+			Udb::OID oid = 0;
+			QString stamp;
+			OutlineDeleg::SavedHeight h;
+			h.d_width = -1;
+			t = in.nextToken();
+			while( t == DataReader::Slot )
+			{
+				const NameTag name = in.getName().getTag();
+				if( name.equals( "oid" ) )
+					oid = in.getValue().getOid();
+				else if( name.equals( "ts" ) )
+					stamp = in.getValue().toString();
+				else if( name.equals( "w" ) )
+					h.d_width = in.getValue().getInt32();
+				else if( name.equals( "sw" ) )
+					h.d_size.setWidth( in.getValue().getInt32() );
+				else if( name.equals( "sh" ) )
+					h.d_size.setHeight( in.getValue().getInt32() );
+				t = in.nextToken();
+			}
+			if( sameStyle && oid != 0 && h.d_width > 0 )
+			{
+				// Nur Items, die seither nicht verändert wurden
+				const Udb::Obj item = d_txn->getObject( oid );
+				if( !item.isNull() && _layoutStamp( item ) == stamp )
+				{
+					heights.insert( oid, h );
+					d_snapStamps.insert( oid, stamp );
+				}
+			}
+		}
+		t = in.nextToken();
+	}
+	if( !heights.isEmpty() )
+		d_deleg->seedHeights( heights );
+	d_snapHeights = heights;
+	if( !setCurrent )
+		return false; // Current und Scroll-Position bestimmt der Aufrufer
+
+	bool restored = false;
+	if( cur != 0 )
+	{
+		const QModelIndex i = d_mdl->getIndex( cur, true );
+		if( i.isValid() )
+		{
+			getTree()->setCurrentIndex( i );
+			restored = true;
+		}
+	}
+	if( top != 0 )
+	{
+		const QModelIndex i = d_mdl->getIndex( top, true );
+		if( i.isValid() )
+			getTree()->scrollTo( i, QAbstractItemView::PositionAtTop );
+	}
+	return restored;
+}
+
 bool OutlineUdbCtrl::addItem()
 {
 	if( getTree()->selectionModel()->selectedRows().size() <= 1 && !d_deleg->isReadOnly() )
@@ -308,9 +524,12 @@ void OutlineUdbCtrl::onIndent()
     const QModelIndex newParentIndex = d_mdl->getIndex( newParent.getOid() );
 	d_mdl->fetchLevel( newParentIndex, true );
 	getTree()->setExpanded( newParentIndex, true ); // Fetch Subs
-    foreach( Udb::Obj item, toIndent )
-        item.aggregateTo( newParent );
-	toIndent.first().commit();
+	{
+		OutlineUdbMdl::Batch b( d_mdl ); // aggregateTo wird als Move gemeldet
+		foreach( Udb::Obj item, toIndent )
+			item.aggregateTo( newParent );
+		toIndent.first().commit();
+	}
     selectItems( toIndent );
     getTree()->goAndEdit( d_mdl->getIndex( cur ) );
 }
@@ -334,11 +553,14 @@ void OutlineUdbCtrl::onUnindent()
 	}while( next.next() );
     if( !nexts.isEmpty() )
 		toUnindent.last().setValue( OutlineItem::AttrIsExpanded, DataCell().setBool( true ) );
-    foreach( Udb::Obj item, toUnindent )
-        item.aggregateTo( newParent, before );
-    foreach( Udb::Obj item, nexts )
-        item.aggregateTo( toUnindent.last() );
-	toUnindent.first().commit();
+	{
+		OutlineUdbMdl::Batch b( d_mdl );
+		foreach( Udb::Obj item, toUnindent )
+			item.aggregateTo( newParent, before );
+		foreach( Udb::Obj item, nexts )
+			item.aggregateTo( toUnindent.last() );
+		toUnindent.first().commit();
+	}
     selectItems( toUnindent );
     getTree()->goAndEdit( d_mdl->getIndex( cur ) );
 }
@@ -361,9 +583,12 @@ void OutlineUdbCtrl::onMoveUp()
 		before = parent;
 		parent = parent.getParent();
 	}
-    foreach( Udb::Obj item, toMove )
-        item.aggregateTo( parent, before );
-	toMove.first().commit();
+	{
+		OutlineUdbMdl::Batch b( d_mdl );
+		foreach( Udb::Obj item, toMove )
+			item.aggregateTo( parent, before );
+		toMove.first().commit();
+	}
     selectItems( toMove );
 	getTree()->goAndEdit( d_mdl->getIndex( cur ) );
 }
@@ -378,9 +603,12 @@ void OutlineUdbCtrl::onMoveDown()
 	d_deleg->closeEdit();
 	const Udb::Obj parent = toMove.last().getParent();
 	const Udb::Obj before = toMove.last().getNext().getNext();
-    foreach( Udb::Obj item, toMove )
-        item.aggregateTo( parent, before );
-    toMove.first().commit();
+	{
+		OutlineUdbMdl::Batch b( d_mdl );
+		foreach( Udb::Obj item, toMove )
+			item.aggregateTo( parent, before );
+		toMove.first().commit();
+	}
     selectItems( toMove );
 	getTree()->goAndEdit( d_mdl->getIndex( cur ) );
 }
@@ -836,34 +1064,57 @@ bool OutlineUdbCtrl::gotoItem( quint64 oid )
     return false;
 }
 
-bool OutlineUdbCtrl::LinkRenderer::renderLink(TextCursor & cur, const QByteArray &data) const
+static LinkCache::Key _linkKey( const Link& link )
 {
-    Q_ASSERT( d_txn != 0 );
-    Link link;
-    if( !link.readFrom( data ) )
-        return false;
-    if( d_txn->getDb()->getDbUuid() != link.d_db )
-    {
-		// cur.insertLink( data, tr("<external reference>") );
-		return false; // Neu, damit Caller den bestehenden Text verwenden kann
-		// Externe Links werden eh als xoid-URL eingebettet, nicht als Link
-    }
-	OutlineItem obj = d_txn->getObject( link.d_oid );
+	quint16 flags = link.d_elide;
+	if( link.d_showIcon )
+		flags |= 0x100;
+	if( link.d_showId )
+		flags |= 0x200;
+	if( link.d_showName )
+		flags |= 0x400;
+	if( link.d_showContext )
+		flags |= 0x800;
+	if( link.d_paraNumber )
+		flags |= 0x1000;
+	if( link.d_showSubName )
+		flags |= 0x2000;
+	return qMakePair( link.d_oid, flags );
+}
+
+static void _resolveLink( Udb::Transaction* txn, Link link, LinkCache::Entry& res )
+{
+	res.d_deps.append( link.d_oid );
+	OutlineItem obj = txn->getObject( link.d_oid );
 	if( obj.isNull(true,true) )
-    {
-        cur.insertLink( data, tr("<null reference>") );
-        return true;
-    }
+	{
+		res.d_null = true;
+		return;
+	}
 	const Udb::Atom type = obj.getType();
 	if( type == OutlineItem::TID )
 	{
 		const Udb::Obj alias = obj.getAlias();
 		if( !alias.isNull() ) // Löse Aliasse auf
+		{
 			obj = alias;
+			res.d_deps.append( obj.getOid() );
+		}
 	}
 	QString nr;
 	if( link.d_paraNumber && type == OutlineItem::TID )
+	{
 		nr = OutlineItem::getParagraphNumber( obj );
+		// Die Nummer hängt von der Position des Items und aller seiner Vorfahren ab
+		Udb::Obj p = obj.getParent();
+		while( !p.isNull() )
+		{
+			res.d_ancestors.append( p.getOid() );
+			if( p.getType() != OutlineItem::TID )
+				break;
+			p = p.getParent();
+		}
+	}
 
 	QString itemName;
 	if( link.d_showContext )
@@ -876,8 +1127,12 @@ bool OutlineUdbCtrl::LinkRenderer::renderLink(TextCursor & cur, const QByteArray
 			{
 				obj = item;
 				link.d_showContext = false;
-			}else if( link.d_showSubName )
-				itemName = item.getText();
+			}else
+			{
+				res.d_deps.append( obj.getOid() );
+				if( link.d_showSubName )
+					itemName = item.getText();
+			}
 		}else
 		{
 			const Udb::Obj parent = obj.getParent();
@@ -894,15 +1149,15 @@ bool OutlineUdbCtrl::LinkRenderer::renderLink(TextCursor & cur, const QByteArray
 						nr = obj.getIdent();
 				}
 				obj = parent;
+				res.d_deps.append( obj.getOid() );
 			}
 		}
 	}
 
-    QString icon;
     if( link.d_showIcon )
-		icon = OutlineUdbMdl::getPixmapPath( obj.getType() );
+		res.d_icon = OutlineUdbMdl::getPixmapPath( obj.getType() );
 
-	QString id;
+	QString& id = res.d_id;
 	if( link.d_showId )
     {
 		id = obj.getAltIdent();
@@ -915,7 +1170,7 @@ bool OutlineUdbCtrl::LinkRenderer::renderLink(TextCursor & cur, const QByteArray
 		name = obj.getText();
 
 	// Zur Verfügung: id, name, itemName, nr, icon
-	QString text;
+	QString& text = res.d_text;
 	if( false ) // name.isEmpty() && itemName.isEmpty() && id.isEmpty() )
 		id = nr;
 	else if( link.d_showContext )
@@ -953,10 +1208,149 @@ bool OutlineUdbCtrl::LinkRenderer::renderLink(TextCursor & cur, const QByteArray
 			text += QString("...");
         }
     }
-	cur.insertLink( data, text, icon, id );
+}
+
+bool OutlineUdbCtrl::LinkRenderer::renderLink(TextCursor & cur, const QByteArray &data) const
+{
+    Q_ASSERT( d_txn != 0 );
+    Link link;
+    if( !link.readFrom( data ) )
+        return false;
+    if( d_txn->getDb()->getDbUuid() != link.d_db )
+    {
+		// cur.insertLink( data, tr("<external reference>") );
+		return false; // Neu, damit Caller den bestehenden Text verwenden kann
+		// Externe Links werden eh als xoid-URL eingebettet, nicht als Link
+    }
+	LinkCache* cache = LinkCache::get( d_txn );
+	const LinkCache::Key key = _linkKey( link );
+	const LinkCache::Entry* res = cache->find( key );
+	if( res == 0 )
+	{
+		LinkCache::Entry e;
+		_resolveLink( d_txn, link, e );
+		cache->insert( key, e );
+		res = cache->find( key );
+	}
+	if( res->d_null )
+		cur.insertLink( data, tr("<null reference>") );
+	else
+		cur.insertLink( data, res->d_text, res->d_icon, res->d_id );
 	return true;
 }
 
+LinkCache::LinkCache( Udb::Transaction* txn ):QObject( txn ),d_txn( txn )
+{
+	txn->getDb()->addObserver( this, SLOT(onDbUpdate( Udb::UpdateInfo )), false );
+}
+
+LinkCache::~LinkCache()
+{
+	// Auch wenn die Transaction vor der DB verschwindet
+	s_linkCaches.remove( d_txn );
+}
+
+LinkCache* LinkCache::get( Udb::Transaction* txn )
+{
+	LinkCache*& self = s_linkCaches[ txn ];
+	if( self == 0 )
+		self = new LinkCache( txn );
+	return self;
+}
+
+const LinkCache::Entry* LinkCache::find( const Key& key ) const
+{
+	QHash<Key,Entry>::const_iterator i = d_entries.find( key );
+	if( i == d_entries.end() )
+		return 0;
+	else
+		return &i.value();
+}
+
+void LinkCache::insert( const Key& key, const Entry& e )
+{
+	if( d_entries.size() >= s_linkCacheSize )
+	{
+		// Was hier rausfaellt, wird nicht mehr verfolgt; die Rows muessen es neu aufloesen
+		clear();
+		emit entriesDropped();
+	}
+	remove( key );
+	d_entries.insert( key, e );
+	foreach( Udb::OID oid, e.d_deps )
+		d_byDep.insert( oid, key );
+	foreach( Udb::OID oid, e.d_ancestors )
+		d_byAncestor.insert( oid, key );
+}
+
+void LinkCache::remove( const Key& key )
+{
+	QHash<Key,Entry>::iterator i = d_entries.find( key );
+	if( i == d_entries.end() )
+		return;
+	foreach( Udb::OID oid, i.value().d_deps )
+		d_byDep.remove( oid, key );
+	foreach( Udb::OID oid, i.value().d_ancestors )
+		d_byAncestor.remove( oid, key );
+	d_entries.erase( i );
+}
+
+bool LinkCache::removeAll( QMultiHash<Udb::OID,Key>& index, Udb::OID oid )
+{
+	// remove ändert den Index, darum zuerst kopieren
+	const QList<Key> keys = index.values( oid );
+	foreach( const Key& key, keys )
+		remove( key );
+	return !keys.isEmpty();
+}
+
+void LinkCache::clear()
+{
+	d_entries.clear();
+	d_byDep.clear();
+	d_byAncestor.clear();
+}
+
+void LinkCache::onDbUpdate( Udb::UpdateInfo info )
+{
+	// Nur wenn ein angezeigter Link betroffen ist, muessen die Modelle ihre Rows mit Links neu layouten
+	bool dropped = false;
+	switch( info.d_kind )
+	{
+	case Udb::UpdateInfo::ValueChanged:
+		if( info.d_name == OutlineItem::AttrText || info.d_name == OutlineItem::AttrIdent ||
+			info.d_name == OutlineItem::AttrAltIdent || info.d_name == OutlineItem::AttrAlias ||
+			info.d_name == OutlineItem::AttrHome )
+			dropped = removeAll( d_byDep, info.d_id );
+		break;
+	case Udb::UpdateInfo::Aggregated:
+	case Udb::UpdateInfo::Deaggregated:
+		// Verschiebt die Paragraphennummern der Items unter d_parent
+		dropped = removeAll( d_byAncestor, info.d_parent );
+		dropped = removeAll( d_byDep, info.d_id ) || dropped;
+		break;
+	case Udb::UpdateInfo::ObjectErased:
+		dropped = removeAll( d_byDep, info.d_id );
+		if( info.d_name == OutlineItem::TID && !d_byAncestor.isEmpty() )
+		{
+			// Der Parent ist nicht mehr bekannt; alle Paragraphennummern neu auflösen
+			const QList<Key> keys = d_byAncestor.values();
+			foreach( const Key& key, keys )
+				remove( key );
+			dropped = true;
+		}
+		break;
+	case Udb::UpdateInfo::DbClosing:
+		s_linkCaches.remove( d_txn );
+		deleteLater();
+		break;
+	default:
+		break;
+	}
+	if( dropped )
+		emit entriesDropped();
+}
+
 QString OutlineUdbCtrl::LinkRenderer::renderHref(const QByteArray &link) const
 {
 	Link l;
@@ -25,9 +25,46 @@
 #include <Udb/Transaction.h>
 #include <Udb/UpdateInfo.h>
 #include <Oln2/LinkSupport.h>
+#include <QHash>
 
 namespace Oln
 {
+	// Aufgeloeste Links einer Transaction; Kind der Transaction und Observer ihrer DB
+	class LinkCache : public QObject
+	{
+		Q_OBJECT
+	public:
+		typedef QPair<Udb::OID,quint16> Key; // (Ziel, Linkflags)
+		struct Entry
+		{
+			QString d_text;
+			QString d_icon;
+			QString d_id;
+			QList<Udb::OID> d_deps; // Ziel, Alias und Home bzw. Parent
+			QList<Udb::OID> d_ancestors; // Parents, von deren Reihenfolge die Paragraphennummer abhaengt
+			bool d_null;
+			Entry():d_null(false) {}
+		};
+		static LinkCache* get( Udb::Transaction* ); // erzeugt bei Bedarf
+		const Entry* find( const Key& ) const;
+		void insert( const Key&, const Entry& );
+	signals:
+		// Aufgeloeste Links sind veraltet oder nicht mehr verfolgt; Rows mit Links neu layouten
+		void entriesDropped();
+	protected slots:
+		void onDbUpdate( Udb::UpdateInfo );
+	private:
+		LinkCache( Udb::Transaction* );
+		~LinkCache();
+		void remove( const Key& );
+		bool removeAll( QMultiHash<Udb::OID,Key>&, Udb::OID ); // true..etwas entfernt
+		void clear();
+		QHash<Key,Entry> d_entries;
+		QMultiHash<Udb::OID,Key> d_byDep; // OID -> Eintraege, die es anzeigen
+		QMultiHash<Udb::OID,Key> d_byAncestor; // Parent -> Eintraege mit Paragraphennummer darunter
+		Udb::Transaction* d_txn;
+	};
+
     class OutlineUdbCtrl : public OutlineCtrl
 	{
 		Q_OBJECT
@@ -41,11 +78,13 @@ namespace Oln
 			LinkRenderer( Udb::Transaction* t ):d_txn(t) {}
             bool renderLink( Txt::TextCursor&, const QByteArray& link ) const;
 			QString renderHref( const QByteArray& link ) const;
+			// Aufgeloeste Links teilen alle Renderer einer Transaction ueber LinkCache
         private:
             Udb::Transaction* d_txn;
         };
 
 		OutlineUdbCtrl( OutlineTree* p, Udb::Transaction* );
+		~OutlineUdbCtrl();
 		OutlineUdbMdl* getMdl() const { return d_mdl; }
 		Udb::Transaction* getTxn() const { return d_txn; }
 		void setOutline( const Udb::Obj&, bool setCurrent = false );
@@ -57,6 +96,11 @@ namespace Oln
 
 		static OutlineUdbCtrl* create( QWidget* p, Udb::Transaction* );
 
+		// Layout-Snapshot pro Outline: Zeilenhoehen, Current und Scroll-Position
+		static void setSnapshotDir( const QString& ); // leer..keine Snapshots
+		static QString getSnapshotDir();
+		void saveSnapshot() const;
+
         void addItemCommands( Gui2::AutoMenu* );
         void addOutlineCommands( Gui2::AutoMenu* );
 
@@ -72,6 +116,9 @@ namespace Oln
         QList<Udb::Obj> getSelectedItems(bool checkConnected = false) const;
         void selectItems( const QList<Udb::Obj>& items );
 		void insertTocImp( const Udb::Obj& item, Udb::Obj& toc, int level );
+		bool loadSnapshot( bool setCurrent );
+		QString getSnapshotPath() const;
+		bool eventFilter( QObject*, QEvent* );
 	public slots:
 		void onAddNext();
 		void onAddLeft();
@@ -97,12 +144,16 @@ namespace Oln
 	protected slots:
 		void onAddNextImp();
 		void onDbUpdate( Udb::UpdateInfo );
+		void onOutlineAboutToChange();
         void followLink( const QByteArray&, bool isUrl );
         void followAlias();
 	private:
 		OutlineUdbMdl* d_mdl;
 		Udb::Transaction* d_txn;
         LinkRenderer d_linkRenderer;
+		// Hoehen anderer Breitenklassen aus dem geladenen Snapshot, werden beim Sichern uebernommen
+		OutlineDeleg::SavedHeights d_snapHeights;
+		QHash<Udb::OID,QString> d_snapStamps; // Stempel der Items in d_snapHeights
 	};
 }
 
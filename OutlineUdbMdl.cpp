@@ -27,6 +27,7 @@
 #include <QMimeData>
 #include <QApplication>
 #include <QClipboard>
+#include <QElapsedTimer>
 #include "OutlineUdbStream.h"
 #include "TextToOutline.h"
 using namespace Oln;
@@ -36,6 +37,11 @@ const char* OutlineUdbMdl::s_mimeOutline = "application/crossline/items";
 
 
 static const int s_batch = 50; // Wenn es weniger sind als eine Seitenlnge gibt es Probleme
+static const int s_maxBatch = 2000;
+static const int s_fetchSlice = 20; // ms, die ein Batch im Leerlauf hchstens dauern soll
+static const int s_resetThreshold = 500; // ab so vielen nderungen in einem Level wird dieses neu geladen
+static const int s_evictDelay = 500; // ms
+static const int s_persistDelay = 1000; // ms Ruhe, bevor Offen/Zu in die Datenbank geschrieben wird
 
 static QMap<quint32, QPair<QString,QString> > s_pix; // typeId -> [path,typeCode]
 static QMap<QString,quint32> s_typeCodes; // typeCode -> typeId
@@ -45,30 +51,125 @@ quint64 OutlineUdbMdl::UdbSlot::getId() const
 	return d_item.getOid();
 }
 
+void OutlineUdbMdl::UdbSlot::loadFlags() const
+{
+	d_flags = FlagsValid;
+	if( d_item.isNull() )
+		return;
+	if( d_item.getValue( OutlineItem::AttrIsTitle ).getBool() )
+		d_flags |= FlagTitle;
+	if( d_item.getValue( OutlineItem::AttrIsExpanded ).getBool() )
+		d_flags |= FlagExpanded;
+	if( d_item.getValue( OutlineItem::AttrIsReadOnly ).getBool() )
+		d_flags |= FlagReadOnly;
+	if( d_item.getValue( OutlineItem::AttrAlias ).isOid() )
+		d_flags |= FlagAlias;
+}
+
+bool OutlineUdbMdl::UdbSlot::testFlag(const OutlineMdl* mdl, Flag f ) const
+{
+	const OutlineUdbMdl* umdl = static_cast<const OutlineUdbMdl*>(mdl);
+	if( d_flags & FlagsValid )
+		umdl->d_flagHits++;
+	else
+	{
+		umdl->d_flagMisses++;
+		loadFlags();
+	}
+	return d_flags & f;
+}
+
 bool OutlineUdbMdl::UdbSlot::isTitle(const OutlineMdl* mdl ) const
 {
-	return d_item.getValue( OutlineItem::AttrIsTitle ).getBool();
+	return testFlag( mdl, FlagTitle );
 }
 
 bool OutlineUdbMdl::UdbSlot::isExpanded(const OutlineMdl* mdl ) const
 {
-	return d_item.getValue( OutlineItem::AttrIsExpanded ).getBool();
+	const OutlineUdbMdl* umdl = static_cast<const OutlineUdbMdl*>(mdl);
+	if( !umdl->d_expanded.isEmpty() )
+	{
+		QHash<quint64,bool>::const_iterator i = umdl->d_expanded.find( getId() );
+		if( i != umdl->d_expanded.end() )
+			return i.value();
+	}
+	return testFlag( mdl, FlagExpanded );
 }
 
 bool OutlineUdbMdl::UdbSlot::isReadOnly(const OutlineMdl* mdl ) const
 {
-	return d_item.getValue( OutlineItem::AttrIsReadOnly ).getBool();
+	return testFlag( mdl, FlagReadOnly );
 }
 
 bool OutlineUdbMdl::UdbSlot::isAlias(const OutlineMdl* mdl ) const
 {
-	return d_item.getValue( OutlineItem::AttrAlias ).isOid();
+	return testFlag( mdl, FlagAlias );
+}
+
+static QVariant _textToVariant( const Stream::DataCell& v )
+{
+	switch( v.getType() )
+	{
+	case Stream::DataCell::TypeAscii:
+	case Stream::DataCell::TypeLatin1:
+	case Stream::DataCell::TypeString:
+		return v.toString();
+	case Stream::DataCell::TypeBml:
+		return QVariant::fromValue( OutlineUdbMdl::Bml( v.getBml() ) );
+	case Stream::DataCell::TypeHtml:
+		return QVariant::fromValue( OutlineUdbMdl::Html( v.getStr() ) );
+	default:
+		return QVariant();
+	}
+}
+
+void OutlineUdbMdl::UdbSlot::fillRowData(const OutlineMdl* mdl, RowData& rd, int parts ) const
+{
+	// Wie getData, aber das Alias wird fr alle Angaben nur einmal aufgelst
+	Udb::Obj alias;
+	if( testFlag( mdl, FlagAlias ) )
+	{
+		alias = d_item.getValueAsObj( OutlineItem::AttrAlias );
+		const OutlineUdbMdl* umdl = static_cast<const OutlineUdbMdl*>(mdl);
+		if( !alias.isNull() && !umdl->d_aliasTargets.contains( alias.getOid(), getId() ) )
+			umdl->d_aliasTargets.insert( alias.getOid(), getId() ); // fr updateAliases
+	}
+	if( parts & RowHead )
+	{
+		QString id = d_item.getString( OutlineItem::AttrAltIdent, true );
+		if( id.isEmpty() )
+			id = d_item.getString( OutlineItem::AttrIdent, true );
+		if( id.isEmpty() && !alias.isNull() )
+		{
+			id = alias.getString( OutlineItem::AttrAltIdent, true );
+			if( id.isEmpty() )
+				id = alias.getString( OutlineItem::AttrIdent, true );
+		}
+		rd.d_ident = id;
+	}
+	if( ( parts & RowDeco ) && testFlag( mdl, FlagAlias ) ) // nur Aliasse zeigen ein Icon
+		rd.d_deco = getPixmap( ( alias.isNull() ) ? d_item.getType() : alias.getType() );
+	if( parts & RowText )
+	{
+		Stream::DataCell v;
+		if( !alias.isNull() )
+			alias.getValue( OutlineItem::AttrText, v );
+		else
+			d_item.getValue( OutlineItem::AttrText, v );
+		rd.d_text = _textToVariant( v );
+		if( rd.d_wantPlain && !v.isHtml() ) // HTML-Titel setzt der Delegate wie bisher mit collectText zusammen
+		{
+			bool complete;
+			const QString str = TextToOutline::toPlainText( v, &complete );
+			rd.d_plain = ( complete ) ? str : QString();
+		}
+	}
 }
 
 QVariant OutlineUdbMdl::UdbSlot::getData(const OutlineMdl* mdl,int role) const
 {
 	//const OutlineUdbMdl* umdl = static_cast<const OutlineUdbMdl*>(mdl);
-	if( role == Qt::DisplayRole || role == Qt::EditRole )
+	if( role == Qt::DisplayRole || role == Qt::EditRole || role == PlainTextRole )
 	{
 		Stream::DataCell v;
 		Stream::DataCell::OID oid = d_item.getValue( OutlineItem::AttrAlias ).getOid();
@@ -85,19 +186,18 @@ QVariant OutlineUdbMdl::UdbSlot::getData(const OutlineMdl* mdl,int role) const
 		}else
             // Falls das Item kein Alias ist
 			d_item.getValue( OutlineItem::AttrText, v );
-		switch( v.getType() )
-		{
-		case Stream::DataCell::TypeAscii:
-		case Stream::DataCell::TypeLatin1:
-		case Stream::DataCell::TypeString:
-			return v.toString();
-		case Stream::DataCell::TypeBml:
-			return QVariant::fromValue( OutlineUdbMdl::Bml( v.getBml() ) );
-		case Stream::DataCell::TypeHtml:
-			return QVariant::fromValue( OutlineUdbMdl::Html( v.getStr() ) );
-        default:
-            break;
+		if( role == PlainTextRole )
+		{
+			if( v.isHtml() )
+				return QVariant(); // wie in fillRowData
+			bool complete;
+			const QString str = TextToOutline::toPlainText( v, &complete );
+			if( complete )
+				return str;
+			else
+				return QVariant(); // Links werden nur vom Delegate aufgelst
 		}
+		return _textToVariant( v );
 	}else if( role == Qt::DecorationRole )
 	{
 		int type = d_item.getType();
@@ -132,8 +232,90 @@ QVariant OutlineUdbMdl::UdbSlot::getData(const OutlineMdl* mdl,int role) const
 	return QVariant();
 }
 
-OutlineUdbMdl::OutlineUdbMdl( QObject* p ):OutlineMdl(p),d_blocked(false)
+OutlineUdbMdl::OutlineUdbMdl( QObject* p ):OutlineMdl(p),d_blocked(false),d_flagHits(0),d_flagMisses(0),d_batch(s_batch),d_batchDepth(0)
+{
+	setSlotSize( sizeof(UdbSlot) );
+	d_fetchTimer.setSingleShot( true );
+	d_fetchTimer.setInterval( 0 );
+	connect( &d_fetchTimer, SIGNAL(timeout()), this, SLOT(onIdleFetch()) );
+	d_evictTimer.setSingleShot( true );
+	d_evictTimer.setInterval( s_evictDelay );
+	connect( &d_evictTimer, SIGNAL(timeout()), this, SLOT(onEvict()) );
+	d_persistTimer.setSingleShot( true );
+	d_persistTimer.setInterval( s_persistDelay );
+	connect( &d_persistTimer, SIGNAL(timeout()), this, SLOT(onPersistExpanded()) );
+}
+
+void OutlineUdbMdl::onPersistExpanded()
+{
+	flushExpanded();
+}
+
+void OutlineUdbMdl::flushExpanded()
+{
+	d_persistTimer.stop();
+	if( d_unsaved.isEmpty() )
+		return;
+	if( d_outline.isNull() || d_outline.getDb()->isReadOnly() )
+	{
+		d_unsaved.clear();
+		return;
+	}
+	// Eigene Transaction, damit nicht halbfertige nderungen des Benutzers mitcommitted werden
+	Udb::Transaction txn( d_outline.getDb() );
+	bool changed = false;
+	QHash<quint64,bool>::const_iterator i;
+	for( i = d_unsaved.begin(); i != d_unsaved.end(); ++i )
+	{
+		Udb::Obj o = txn.getObject( i.key() );
+		if( !o.isNull() && o.getValue( OutlineItem::AttrIsExpanded ).getBool() != i.value() )
+		{
+			o.setValue( OutlineItem::AttrIsExpanded, Stream::DataCell().setBool( i.value() ) );
+			changed = true;
+		}
+	}
+	if( changed )
+		txn.commit();
+	// d_expanded bleibt; ein anderer View kann AttrIsExpanded inzwischen wieder berschreiben
+	d_unsaved.clear();
+}
+
+void OutlineUdbMdl::onLinksChanged()
+{
+	bumpDependencyGen(); // ein angezeigter Linktext oder eine Paragraphennummer ist veraltet
+}
+
+void OutlineUdbMdl::updateAliases( quint64 target )
+{
+	// Nur die Aliasse dieses Ziels bekommen eine neue Revision, nicht alle Rows mit Abhngigkeiten
+	QMultiHash<quint64,quint64>::iterator i = d_aliasTargets.find( target );
+	while( i != d_aliasTargets.end() && i.key() == target )
+	{
+		UdbSlot* s = findSlot( i.value() );
+		if( s == 0 )
+		{
+			i = d_aliasTargets.erase( i ); // inzwischen verdrngt
+			continue;
+		}
+		bumpRevision( s );
+		const QModelIndex index = createIndex( s->getRow(), 0, s );
+		emit dataChanged( index, index );
+		++i;
+	}
+}
+
+void OutlineUdbMdl::dropUnloadedExpanded()
 {
+	// Nur Items mit Slot brauchen den Zustand dieses Views; beim Nachladen gilt wieder AttrIsExpanded.
+	// So wchst d_expanded nicht mit jedem je geklickten Item.
+	QHash<quint64,bool>::iterator i = d_expanded.begin();
+	while( i != d_expanded.end() )
+	{
+		if( !d_unsaved.contains( i.key() ) && findSlot( i.key() ) == 0 )
+			i = d_expanded.erase( i );
+		else
+			++i;
+	}
 }
 
 OutlineUdbMdl::UdbSlot* OutlineUdbMdl::getSlot( const QModelIndex& index ) const
@@ -148,8 +330,15 @@ OutlineUdbMdl::UdbSlot* OutlineUdbMdl::findSlot( quint64 id ) const
 
 void OutlineUdbMdl::setOutline( const Udb::Obj& doc )
 {
+	if( !d_outline.isNull() )
+		emit outlineAboutToChange();
+	flushExpanded();
+	d_expanded.clear();
+	d_aliasTargets.clear();
 	d_outline = doc;
-	UdbSlot* s = new UdbSlot();
+	d_pendingFetch.clear();
+	d_fetchTimer.stop();
+	UdbSlot* s = createSlot<UdbSlot>();
 	if( !d_outline.isNull() )
 		s->d_item = d_outline; // wozu eigentlich?
 	add( s, 0 );
@@ -184,25 +373,60 @@ bool OutlineUdbMdl::canFetchMore ( const QModelIndex & parent ) const
 	return n > 0;
 }
 
-int OutlineUdbMdl::fetch( UdbSlot* p, int max, ObjList* l ) const
+static bool _seekItem( Obj& o )
+{
+	// Geht ab o (inklusive) zum nchsten Outline-Item
+	if( o.isNull() )
+		return false;
+	while( o.getType() != OutlineItem::TID )
+	{
+		if( !o.next() )
+			return false;
+	}
+	return true;
+}
+
+void OutlineUdbMdl::seek( UdbSlot* p ) const
 {
-	Q_ASSERT( p != 0 );
 	Obj o;
 	if( p->getSubs().isEmpty() )
-	{
 		o = p->d_item.getFirstObj();
-	}else
+	else
 	{
 		o = static_cast<UdbSlot*>( p->getSubs().last() )->d_item;
-		if( !o.isNull() )
-		{
-			if( !o.next() )
-				return 0;
-		}
+		if( !o.isNull() && !o.next() )
+			o = Obj();
+	}
+	if( _seekItem( o ) )
+	{
+		p->d_next = o;
+		p->d_cursor = UdbSlot::CursorAt;
+	}else
+	{
+		p->d_next = Obj();
+		p->d_cursor = UdbSlot::CursorEnd;
 	}
+}
+
+void OutlineUdbMdl::invalidateCursor( quint64 parent )
+{
+	UdbSlot* p = ( parent == d_outline.getOid() ) ? static_cast<UdbSlot*>( getRoot() ) : findSlot( parent );
+	if( p )
+		p->resetCursor();
+}
+
+int OutlineUdbMdl::fetch( UdbSlot* p, int max, ObjList* l ) const
+{
+	Q_ASSERT( p != 0 );
+	// Der Cursor wird nur durch create weiterbewegt; Aggregated/Deaggregated setzen ihn zurck
+	if( p->d_cursor == UdbSlot::CursorUnknown )
+		seek( p );
+	if( p->d_cursor == UdbSlot::CursorEnd )
+		return 0;
+	Obj o = p->d_next;
 
 	int n = 0;
-	if( !o.isNull() ) do
+	do
 	{
 		if( o.getType() == OutlineItem::TID )
 		{
@@ -219,7 +443,7 @@ int OutlineUdbMdl::fetch( UdbSlot* p, int max, ObjList* l ) const
 				l->append( o );
 			n++;
 		}
-	}while( o.next() && ( max == 0 || n < max ) );
+	}while( ( max == 0 || n < max ) && o.next() );
 	return n;
 }
 
@@ -230,11 +454,26 @@ void OutlineUdbMdl::create( UdbSlot* p, const ObjList& l )
         // TEST
 		//qDebug() << "fetching" << l[i].getValue( OutlineItem::AttrText ).toPrettyString();
 		//qDebug() << "to parent" << d_outline.getObject( p->getId() ).getValue( OutlineItem::AttrText ).toPrettyString();
-		UdbSlot* s = new UdbSlot();
+		UdbSlot* s = createSlot<UdbSlot>();
 		s->d_item = l[i];
+		s->loadFlags();
 		Q_ASSERT( p != 0 );
 		add( s, p );
 	}
+	if( getSlotBudget() > 0 && getSlotCount() > getSlotBudget() && !d_evictTimer.isActive() )
+		d_evictTimer.start();
+	if( l.isEmpty() )
+		return;
+	Obj o = l.last();
+	if( o.next() && _seekItem( o ) )
+	{
+		p->d_next = o;
+		p->d_cursor = UdbSlot::CursorAt;
+	}else
+	{
+		p->d_next = Obj();
+		p->d_cursor = UdbSlot::CursorEnd;
+	}
 }
 
 void OutlineUdbMdl::fetchMore ( const QModelIndex & parent )
@@ -246,8 +485,67 @@ void OutlineUdbMdl::fetchMore ( const QModelIndex & parent )
         //qDebug() << "calling fetchMore during Deaggregate";
 		return;
 	}
-	fetchLevel( parent, parent.isValid() ); 
-	// Da QTreeView nur bei expand fetchMore aufruft, laden wir gleich alles
+	// Zuerst was der Viewport braucht, der Rest wird im Leerlauf nachgeladen
+	fetchLevel( parent );
+	scheduleFetch( parent );
+}
+
+void OutlineUdbMdl::onEvict()
+{
+	// Etwas unter das Budget, damit nicht bei jedem Fetch wieder verdrngt wird
+	if( getSlotBudget() > 0 && !d_outline.isNull() && evict( getSlotBudget() * 9 / 10 ) > 0 )
+		dropUnloadedExpanded();
+}
+
+void OutlineUdbMdl::scheduleFetch( const QModelIndex& parent )
+{
+	if( d_outline.isNull() || !canFetchMore( parent ) )
+		return;
+	const quint64 oid = ( parent.isValid() ) ? getSlot( parent )->getId() : d_outline.getOid();
+	if( !d_pendingFetch.contains( oid ) )
+		d_pendingFetch.append( oid );
+	if( !isOverBudget() )
+		d_fetchTimer.start( 0 );
+	else if( !d_fetchTimer.isActive() )
+		// Nach der Verdrngung nochmals versuchen, sonst bleibt die Anfrage liegen
+		d_fetchTimer.start( s_evictDelay );
+}
+
+void OutlineUdbMdl::onIdleFetch()
+{
+	while( !d_pendingFetch.isEmpty() && !isOverBudget() )
+	{
+		const quint64 oid = d_pendingFetch.first();
+		QModelIndex parent;
+		if( oid != d_outline.getOid() )
+		{
+			parent = getIndex( oid );
+			if( !parent.isValid() )
+			{
+				// Parent wurde inzwischen aus dem Cache entfernt
+				d_pendingFetch.removeFirst();
+				continue;
+			}
+		}
+		if( !canFetchMore( parent ) )
+		{
+			d_pendingFetch.removeFirst();
+			continue;
+		}
+		QElapsedTimer t;
+		t.start();
+		fetchLevel( parent );
+		const qint64 ms = t.elapsed();
+		// Batch-Grsse so nachfhren, dass ein Batch etwa s_fetchSlice dauert
+		if( ms < s_fetchSlice / 2 )
+			d_batch = qMin( d_batch * 2, s_maxBatch );
+		else if( ms > s_fetchSlice )
+			d_batch = qMax( int( d_batch * s_fetchSlice / ms ), s_batch );
+		d_fetchTimer.start( 0 ); // Event-Loop dazwischen lassen
+		return;
+	}
+	if( !d_pendingFetch.isEmpty() )
+		d_fetchTimer.start( s_evictDelay ); // Budget erschpft
 }
 
 void OutlineUdbMdl::fetchLevel( const QModelIndex & parent, bool all )
@@ -257,7 +555,7 @@ void OutlineUdbMdl::fetchLevel( const QModelIndex & parent, bool all )
 
 	UdbSlot* p = getSlot( parent );
 	ObjList l;
-    fetch( p, (all)?0:s_batch, &l );
+    fetch( p, (all)?0:d_batch, &l );
 	if( l.isEmpty() )
 		return;
 
@@ -280,6 +578,16 @@ void OutlineUdbMdl::fetchAll()
 }
 
 void OutlineUdbMdl::onDbUpdate( Udb::UpdateInfo info )
+{
+	if( d_outline.isNull() )
+		return;
+	if( d_batchDepth > 0 )
+		d_batched.append( info );
+	else
+		handleUpdate( info );
+}
+
+void OutlineUdbMdl::handleUpdate( const Udb::UpdateInfo& info )
 {
 	if( d_outline.isNull() )
 		return;
@@ -290,17 +598,29 @@ void OutlineUdbMdl::onDbUpdate( Udb::UpdateInfo info )
 		break;
 	case UpdateInfo::ValueChanged:
 		{
+			if( info.d_name == OutlineItem::AttrIsTitle || info.d_name == OutlineItem::AttrIsExpanded ||
+				info.d_name == OutlineItem::AttrIsReadOnly || info.d_name == OutlineItem::AttrAlias )
+			{
+				UdbSlot* s = findSlot( info.d_id );
+				if( s )
+					s->loadFlags();
+			}
 			const QModelIndex i = getIndex( info.d_id );
 			if( i.isValid() && 
-				( info.d_name == OutlineItem::AttrText || info.d_name == OutlineItem::AttrIsTitle || info.d_name == OutlineItem::AttrIsReadOnly ) )
+				( info.d_name == OutlineItem::AttrText || info.d_name == OutlineItem::AttrIsTitle ||
+				  info.d_name == OutlineItem::AttrIsReadOnly || info.d_name == OutlineItem::AttrAlias ) )
 			{
+				bumpRevision( getSlot( i ) );
 				emit dataChanged( i, i );
 			}
-			// TODO: update, wenn ein Zielobjekt eines Alias-Items gendert wurde?
+			if( info.d_name == OutlineItem::AttrText || info.d_name == OutlineItem::AttrIdent ||
+				info.d_name == OutlineItem::AttrAltIdent )
+				updateAliases( info.d_id ); // Aliasse zeigen Text und Ident ihres Ziels
 		}
 		break;
 	case UpdateInfo::Deaggregated:
 		{
+			invalidateCursor( info.d_parent );
 			const QModelIndex parentIndex = getIndex( info.d_parent );
 			if( !parentIndex.isValid() && info.d_parent != d_outline.getOid() )
 				break; // Das Parent-Objekt ist nicht dieses Outline
@@ -323,6 +643,7 @@ void OutlineUdbMdl::onDbUpdate( Udb::UpdateInfo info )
 		break;
 	case UpdateInfo::Aggregated:
 		{
+			invalidateCursor( info.d_parent );
 			const QModelIndex parentIndex = getIndex( info.d_parent );
 			if( !parentIndex.isValid() && info.d_parent != d_outline.getOid() )
 				break; // Das Parent-Objekt ist noch nicht bekannt. Fetch offensichtlich noch pendent.
@@ -351,23 +672,27 @@ void OutlineUdbMdl::onDbUpdate( Udb::UpdateInfo info )
 			if( info.d_before )
 			{
 				UdbSlot* beforeSlot = findSlot( info.d_before );
-				const int row = parentSlot->getSubs().indexOf( beforeSlot );
+				const int row = ( beforeSlot && beforeSlot->getSuper() == parentSlot ) ? beforeSlot->getRow() : -1;
 				if( row < 0 )
 					break; // TODO: kann -1 sein, wenn CRTL+R auf geschlossenem Element
 				beginInsertRows( parentIndex, row, row );
-				UdbSlot* newSlot = new UdbSlot();
+				UdbSlot* newSlot = createSlot<UdbSlot>();
 				newSlot->d_item = objToAdd;
+				newSlot->loadFlags();
 				add( newSlot, parentSlot, row );
 				endInsertRows();
-			}else
+			}else if( isNextToLoad( parentSlot, objToAdd.getOid() ) )
 			{
 				const int size = parentSlot->getSubs().size();
 				beginInsertRows( parentIndex, size, size );
-				UdbSlot* newSlot = new UdbSlot();
+				UdbSlot* newSlot = createSlot<UdbSlot>();
 				newSlot->d_item = objToAdd;
+				newSlot->loadFlags();
 				add( newSlot, parentSlot );
 				endInsertRows();
+				invalidateCursor( info.d_parent );
 			}
+			// sonst sind noch nicht alle Vorgnger geladen; das neue Item holt der Cursor
 		}
 		break;
 	case UpdateInfo::ObjectErased:
@@ -377,6 +702,320 @@ void OutlineUdbMdl::onDbUpdate( Udb::UpdateInfo info )
 	}
 }
 
+void OutlineUdbMdl::endBatch()
+{
+	Q_ASSERT( d_batchDepth > 0 );
+	d_batchDepth--;
+	if( d_batchDepth == 0 && !d_batched.isEmpty() )
+		flushBatch();
+}
+
+bool OutlineUdbMdl::isRelevant( const Udb::UpdateInfo& info ) const
+{
+	// Notifikationen zu Objekten, die (noch) nicht geladen sind, haben keine Wirkung auf das Modell
+	switch( info.d_kind )
+	{
+	case UpdateInfo::DbClosing:
+		return true;
+	case UpdateInfo::ObjectErased:
+		return info.d_id == d_outline.getOid();
+	case UpdateInfo::ValueChanged:
+		if( ( info.d_name == OutlineItem::AttrText || info.d_name == OutlineItem::AttrIdent ||
+			  info.d_name == OutlineItem::AttrAltIdent ) && d_aliasTargets.contains( info.d_id ) )
+			return true;
+		if( info.d_name != OutlineItem::AttrText && info.d_name != OutlineItem::AttrIsTitle &&
+			info.d_name != OutlineItem::AttrIsReadOnly && info.d_name != OutlineItem::AttrIsExpanded &&
+			info.d_name != OutlineItem::AttrAlias )
+			return false; // handleUpdate reagiert nur auf diese Attribute
+		return findSlot( info.d_id ) != 0;
+	case UpdateInfo::Aggregated:
+	case UpdateInfo::Deaggregated:
+		return info.d_parent == d_outline.getOid() || findSlot( info.d_parent ) != 0;
+	default:
+		return false;
+	}
+}
+
+void OutlineUdbMdl::flushBatch()
+{
+	const QList<Udb::UpdateInfo> l = d_batched;
+	d_batched.clear();
+
+	// Levels mit sehr vielen nderungen werden als Ganzes neu geladen
+	QHash<quint64,int> counts;
+	for( int i = 0; i < l.size(); i++ )
+	{
+		if( l[i].d_kind == UpdateInfo::Aggregated || l[i].d_kind == UpdateInfo::Deaggregated )
+			counts[ l[i].d_parent ]++;
+	}
+	QSet<quint64> resets;
+	QHash<quint64,int>::const_iterator j;
+	for( j = counts.begin(); j != counts.end(); ++j )
+	{
+		if( j.value() < s_resetThreshold )
+			continue;
+		if( j.key() == d_outline.getOid() )
+		{
+			resets.insert( j.key() );
+			clearCache( QModelIndex() );
+		}else
+		{
+			const QModelIndex parent = getIndex( j.key() );
+			if( parent.isValid() )
+			{
+				resets.insert( j.key() );
+				clearCache( parent );
+			}
+		}
+		invalidateCursor( j.key() );
+	}
+
+	int i = 0;
+	while( i < l.size() && !d_outline.isNull() )
+	{
+		const Udb::UpdateInfo& info = l[i];
+		if( !isRelevant( info ) || 
+			( ( info.d_kind == UpdateInfo::Aggregated || info.d_kind == UpdateInfo::Deaggregated ) &&
+			  resets.contains( info.d_parent ) ) )
+		{
+			i++;
+			continue;
+		}
+		int a = nextRelevant( l, i + 1 );
+		if( info.d_kind == UpdateInfo::Deaggregated && a < l.size() && l[a].d_kind == UpdateInfo::Aggregated &&
+			l[a].d_id == info.d_id && !resets.contains( l[a].d_parent ) )
+		{
+			// aggregateTo eines bereits aggregierten Objekts: Deaggregated gefolgt von Aggregated ist ein Move.
+			// Aufeinanderfolgende Moves vom gleichen Parent an die gleiche Stelle werden zusammengefasst.
+			QList<Udb::UpdateInfo> rem;
+			QList<Udb::UpdateInfo> ins;
+			rem.append( info );
+			ins.append( l[a] );
+			int k = nextRelevant( l, a + 1 );
+			while( k < l.size() && l[k].d_kind == UpdateInfo::Deaggregated && l[k].d_parent == info.d_parent )
+			{
+				a = nextRelevant( l, k + 1 );
+				if( a >= l.size() || l[a].d_kind != UpdateInfo::Aggregated || l[a].d_id != l[k].d_id ||
+					l[a].d_parent != ins.first().d_parent || l[a].d_before != ins.first().d_before )
+					break;
+				rem.append( l[k] );
+				ins.append( l[a] );
+				k = nextRelevant( l, a + 1 );
+			}
+			moveRun( rem, ins );
+			i = k;
+		}else if( info.d_kind == UpdateInfo::Aggregated || info.d_kind == UpdateInfo::Deaggregated )
+		{
+			// Lauf von Notifikationen gleicher Art zum gleichen Parent (und beim Einfgen zum gleichen Before);
+			// irrelevante Notifikationen dazwischen unterbrechen den Lauf nicht
+			QList<quint64> ids;
+			ids.append( info.d_id );
+			int k = i + 1;
+			while( k < l.size() )
+			{
+				const Udb::UpdateInfo& next = l[k];
+				if( next.d_kind == info.d_kind && next.d_parent == info.d_parent &&
+					( info.d_kind == UpdateInfo::Deaggregated || next.d_before == info.d_before ) )
+					ids.append( next.d_id );
+				else if( isRelevant( next ) )
+					break;
+				k++;
+			}
+			if( ids.size() == 1 )
+				handleUpdate( info );
+			else if( info.d_kind == UpdateInfo::Aggregated )
+				insertRun( info.d_parent, info.d_before, ids );
+			else
+				removeRun( info.d_parent, ids );
+			i = k;
+		}else
+		{
+			handleUpdate( info );
+			i++;
+		}
+	}
+
+	foreach( quint64 oid, resets )
+	{
+		if( d_outline.isNull() )
+			break;
+		const QModelIndex parent = ( oid == d_outline.getOid() ) ? QModelIndex() : getIndex( oid );
+		if( parent.isValid() || oid == d_outline.getOid() )
+		{
+			fetchLevel( parent );
+			scheduleFetch( parent );
+		}
+	}
+}
+
+int OutlineUdbMdl::nextRelevant( const QList<Udb::UpdateInfo>& l, int from ) const
+{
+	while( from < l.size() && !isRelevant( l[from] ) )
+		from++;
+	return from;
+}
+
+void OutlineUdbMdl::moveRun( const QList<Udb::UpdateInfo>& rem, const QList<Udb::UpdateInfo>& ins )
+{
+	Q_ASSERT( !rem.isEmpty() && rem.size() == ins.size() );
+	const quint64 from = rem.first().d_parent;
+	const quint64 to = ins.first().d_parent;
+	const quint64 before = ins.first().d_before;
+	invalidateCursor( from );
+	invalidateCursor( to );
+	UdbSlot* fromSlot = ( from == d_outline.getOid() ) ? static_cast<UdbSlot*>( getRoot() ) : findSlot( from );
+	UdbSlot* toSlot = ( to == d_outline.getOid() ) ? static_cast<UdbSlot*>( getRoot() ) : findSlot( to );
+	// Ein leeres Ziel-Level wurde vermutlich noch nicht geladen, und beim Anhngen mssen alle
+	// Vorgnger geladen sein; sonst wie bisher entfernen und neu laden.
+	bool canMove = fromSlot != 0 && toSlot != 0 && !toSlot->getSubs().isEmpty();
+	if( canMove && before == 0 )
+		canMove = fetch( toSlot, 1 ) == 0;
+	int i = 0;
+	while( i < rem.size() && !d_outline.isNull() )
+	{
+		UdbSlot* s = findSlot( rem[i].d_id );
+		int dest = -1;
+		if( canMove && s != 0 && s->getSuper() == fromSlot )
+		{
+			if( before == 0 )
+				dest = toSlot->getSubs().size();
+			else
+			{
+				UdbSlot* b = findSlot( before );
+				if( b != 0 && b->getSuper() == toSlot )
+					dest = b->getRow();
+			}
+		}
+		if( dest < 0 )
+		{
+			handleUpdate( rem[i] );
+			handleUpdate( ins[i] );
+			i++;
+			continue;
+		}
+		// Zusammenhngende Rows im Quell-Level in einem Schritt verschieben
+		const int first = s->getRow();
+		int n = 1;
+		while( i + n < rem.size() )
+		{
+			UdbSlot* t = findSlot( rem[i + n].d_id );
+			if( t != 0 && t->getSuper() == fromSlot && t->getRow() == first + n )
+				n++;
+			else
+				break;
+		}
+		if( fromSlot == toSlot && dest >= first && dest <= first + n )
+		{
+			i += n; // Reihenfolge ndert sich nicht
+			continue;
+		}
+		const QModelIndex fromIndex = ( fromSlot == getRoot() ) ? QModelIndex() : createIndex( fromSlot->getRow(), 0, fromSlot );
+		const QModelIndex toIndex = ( toSlot == getRoot() ) ? QModelIndex() : createIndex( toSlot->getRow(), 0, toSlot );
+		if( beginMoveRows( fromIndex, first, first + n - 1, toIndex, dest ) )
+		{
+			move( fromSlot, first, first + n - 1, toSlot, dest );
+			endMoveRows();
+		}else
+		{
+			for( int j = i; j < i + n; j++ )
+			{
+				handleUpdate( rem[j] );
+				handleUpdate( ins[j] );
+			}
+		}
+		i += n;
+	}
+}
+
+void OutlineUdbMdl::insertRun( quint64 parent, quint64 before, const QList<quint64>& ids )
+{
+	invalidateCursor( parent );
+	const QModelIndex parentIndex = ( parent == d_outline.getOid() ) ? QModelIndex() : getIndex( parent );
+	if( !parentIndex.isValid() && parent != d_outline.getOid() )
+		return;
+	UdbSlot* parentSlot = getSlot( parentIndex );
+	ObjList l;
+	for( int i = 0; i < ids.size(); i++ )
+	{
+		if( findSlot( ids[i] ) )
+			continue; // bereits geladen
+		Udb::Obj o = d_outline.getObject( ids[i] );
+		if( !o.isNull() && o.getType() == OutlineItem::TID )
+			l.append( o );
+	}
+	if( l.isEmpty() )
+		return;
+	if( parentSlot->getSubs().isEmpty() )
+	{
+		// wie bei Einzel-Notifikation: Fetch hat noch nicht stattgefunden
+		fetchLevel( parentIndex );
+		return;
+	}
+	int row = parentSlot->getSubs().size();
+	if( before == 0 && !isNextToLoad( parentSlot, l.first().getOid() ) )
+		return; // noch nicht alle Vorgnger geladen; die neuen Items holt der Cursor
+	if( before )
+	{
+		UdbSlot* beforeSlot = findSlot( before );
+		if( beforeSlot == 0 || beforeSlot->getSuper() != parentSlot )
+			return;
+		row = beforeSlot->getRow();
+	}
+	beginInsertRows( parentIndex, row, row + l.size() - 1 );
+	for( int i = 0; i < l.size(); i++ )
+	{
+		UdbSlot* newSlot = createSlot<UdbSlot>();
+		newSlot->d_item = l[i];
+		newSlot->loadFlags();
+		add( newSlot, parentSlot, row + i );
+	}
+	endInsertRows();
+	invalidateCursor( parent );
+}
+
+bool OutlineUdbMdl::isNextToLoad( UdbSlot* p, quint64 oid ) const
+{
+	// Ein angehngtes Item darf nur direkt hinter die geladenen Rows, wenn es auch in der DB
+	// unmittelbar darauf folgt; analog zu fetch( toSlot, 1 ) in moveRun
+	ObjList l;
+	return fetch( p, 1, &l ) == 1 && l.first().getOid() == oid;
+}
+
+void OutlineUdbMdl::removeRun( quint64 parent, const QList<quint64>& ids )
+{
+	invalidateCursor( parent );
+	const QModelIndex parentIndex = ( parent == d_outline.getOid() ) ? QModelIndex() : getIndex( parent );
+	if( !parentIndex.isValid() && parent != d_outline.getOid() )
+		return;
+	UdbSlot* parentSlot = getSlot( parentIndex );
+	QSet<int> found;
+	for( int i = 0; i < ids.size(); i++ )
+	{
+		UdbSlot* s = findSlot( ids[i] );
+		if( s && s->getSuper() == parentSlot )
+			found.insert( s->getRow() );
+	}
+	if( found.isEmpty() )
+		return;
+	QList<int> rows = found.toList();
+	qSort( rows );
+	// Zusammenhngende Bereiche von hinten nach vorne entfernen, damit die Rows gltig bleiben
+	d_blocked = true;
+	int last = rows.size() - 1;
+	while( last >= 0 )
+	{
+		int first = last;
+		while( first > 0 && rows[first - 1] == rows[first] - 1 )
+			first--;
+		beginRemoveRows( parentIndex, rows[first], rows[last] );
+		for( int r = rows[last]; r >= rows[first]; r-- )
+			remove( parentSlot->getSubs()[r] );
+		endRemoveRows();
+		last = first - 1;
+	}
+	d_blocked = false;
+}
+
 bool OutlineUdbMdl::setData ( const QModelIndex & index, const QVariant & value, int role )  
 {
 	if( d_outline.isNull() )
@@ -384,6 +1023,7 @@ bool OutlineUdbMdl::setData ( const QModelIndex & index, const QVariant & value,
 	if( role == Qt::SizeHintRole )
 	{
 		// Trick um Height-Cache zu invalidieren
+		bumpRevision( getSlot( index ) );
 		emit dataChanged( index, index );
 		return true;
 	}else if( role == Qt::EditRole )
@@ -403,6 +1043,7 @@ bool OutlineUdbMdl::setData ( const QModelIndex & index, const QVariant & value,
 			s->d_item.setValue( OutlineItem::AttrText, v );
 			s->d_item.setValue( OutlineItem::AttrModifiedOn, Stream::DataCell().setDateTime( QDateTime::currentDateTime() ) );
 			d_outline.commit();
+			bumpRevision( s );
 			emit dataChanged( index, index );
 		}
 		return true;
@@ -410,10 +1051,15 @@ bool OutlineUdbMdl::setData ( const QModelIndex & index, const QVariant & value,
 	{
 		UdbSlot* s = getSlot( index );
 		const bool exp = value.toBool();
-		s->d_item.setValue( OutlineItem::AttrIsExpanded, Stream::DataCell().setBool( exp ) );
-		d_outline.commit();
+		// Kein Commit pro Klick; bei Expand All wren das Tausende
+		d_expanded[s->getId()] = exp;
+		d_unsaved[s->getId()] = exp;
+		d_persistTimer.start();
 		if( !exp )
+		{
 			clearCache( index );
+			dropUnloadedExpanded();
+		}
 		return true;
 	}
 	return false;
@@ -453,9 +1099,7 @@ QModelIndex OutlineUdbMdl::getIndex( quint64 oid, bool fetch ) const
 	if( s != 0 )
 	{
 		// Das Objekt wurde bereits geladen.
-		const int row = s->getSuper()->getSubs().indexOf( s );
-		Q_ASSERT( row >= 0 );
-		return createIndex( row, 0, s );
+		return createIndex( s->getRow(), 0, s );
 	}
 	// Das Objekt wurde noch nicht geladen
 	QModelIndex res;
@@ -506,6 +1150,20 @@ QModelIndex OutlineUdbMdl::findInLevel( const QModelIndex & parent, quint64 oid
 	return QModelIndex();
 }
 
+struct _SlotPlainText : public TextToOutline::PlainTextCache
+{
+	// Geladene Slots liefern ihren gecachten Plaintext; alle anderen liest toText selber
+	const OutlineUdbMdl* d_mdl;
+	_SlotPlainText( const OutlineUdbMdl* mdl ):d_mdl(mdl) {}
+	QString getPlainText( const Udb::Obj& item ) const
+	{
+		const QModelIndex i = d_mdl->getIndex( item.getOid() );
+		if( !i.isValid() )
+			return QString();
+		return i.data( OutlineMdl::PlainTextRole ).toString(); // null falls unvollstndig oder Html
+	}
+};
+
 QMimeData * OutlineUdbMdl::mimeData ( const QModelIndexList & indexes ) const
 {
 	// NOTE: alle Elemente von indexes mssen denselben Parent haben, damit sie hier verarbeitet werden.
@@ -525,6 +1183,7 @@ QMimeData * OutlineUdbMdl::mimeData ( const QModelIndexList & indexes ) const
 	Stream::DataWriter out2;
 	QString out3;
     QList<QUrl> urls;
+	_SlotPlainText cache( this );
 	out1.writeSlot( Stream::DataCell().setUuid( d_outline.getDb()->getDbUuid() ) );
 	for( int i = 0; i < idx.size(); i++ )
 	{
@@ -533,7 +1192,7 @@ QMimeData * OutlineUdbMdl::mimeData ( const QModelIndexList & indexes ) const
 			Udb::Obj o = getItem( idx[i] );
 			out1.writeSlot( o );
 			OutlineUdbStream::writeItem( out2, o, i == 0 );
-			out3 += TextToOutline::toText( o );
+			out3 += TextToOutline::toText( o, &cache );
 			urls.append( objToUrl( o ) );
 		}
 	}
@@ -570,6 +1229,7 @@ static void dump( const Udb::Obj& o, int level )
 
 QList<Udb::Obj> OutlineUdbMdl::loadFromText( const QString& text, int row, const QModelIndex & parent )
 {
+	Batch b( this );
 	const Udb::Obj p = getItem( parent );
 	if( p.isNull() )
 		return QList<Udb::Obj>();
@@ -595,6 +1255,7 @@ QList<Udb::Obj> OutlineUdbMdl::loadFromText( const QString& text, int row, const
 
 Udb::Obj OutlineUdbMdl::loadFromHtml( const QString& html, int row, const QModelIndex & parent, bool rooted )
 {
+	Batch b( this );
 	const Udb::Obj p = getItem( parent );
 	if( p.isNull() )
 		return Udb::Obj();
@@ -631,6 +1292,7 @@ Udb::Obj OutlineUdbMdl::loadFromHtml( const QString& html, int row, const QModel
 bool OutlineUdbMdl::moveOrLinkRefs( const QByteArray& bml, const Udb::Obj& parent, const Udb::Obj& before, 
 								   bool link, bool docLink )
 {
+	Batch b( this );
 	Stream::DataReader in( bml );
 	if( in.nextToken() == Stream::DataReader::Slot && in.readValue().getUuid() == d_outline.getDb()->getDbUuid() )
 	{
@@ -684,6 +1346,7 @@ bool OutlineUdbMdl::moveOrLinkRefs( const QByteArray& bml, const Udb::Obj& paren
 
 bool OutlineUdbMdl::dropBml( const QByteArray& bml, const QModelIndex& parent, int row, Action action )
 {
+	Batch b( this );
 	const Udb::Obj p = getItem( parent );
 	if( p.isNull() )
 		return false;
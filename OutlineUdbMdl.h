@@ -22,7 +22,9 @@
 
 #include <Oln2/OutlineMdl.h>
 #include <QPixmap>
+#include <QTimer>
 #include <Udb/Obj.h>
+#include <Udb/UpdateInfo.h>
 
 namespace Oln
 {
@@ -54,6 +56,21 @@ namespace Oln
 		
 		bool isReadOnly() const; // override
 
+		// Offen/zu gilt nur fr diesen View; AttrIsExpanded ist der Default und wird verzgert nachgefhrt
+		// Schreibt alle ausstehenden nderungen in einer eigenen Transaktion; der Destruktor fasst die DB
+		// nicht mehr an, darum ruft OutlineUdbCtrl flushExpanded vor dem Lschen auf
+		void flushExpanded();
+
+		// Sammelt die Notifikationen bis zum ussersten endBatch und meldet sie in Bereichen zusammengefasst
+		void beginBatch() { d_batchDepth++; }
+		void endBatch();
+		struct Batch
+		{
+			Batch( OutlineUdbMdl* mdl ):d_mdl(mdl) { d_mdl->beginBatch(); }
+			~Batch() { d_mdl->endBatch(); }
+			OutlineUdbMdl* d_mdl;
+		};
+
 		static QPixmap getPixmap( quint32 typeId );
 		static QString getPixmapPath( quint32 typeId );
         static QString getTypeCode( quint32 typeId );
@@ -63,6 +80,11 @@ namespace Oln
 		static void writeObjectUrls(QMimeData *data, const QList<Udb::Obj>& );
 		static QUrl objToUrl(const Udb::Obj & o);
 
+		// Statistik des Flag-Caches der Slots
+		quint32 getFlagHits() const { return d_flagHits; }
+		quint32 getFlagMisses() const { return d_flagMisses; }
+		void resetFlagStats() { d_flagHits = d_flagMisses = 0; }
+
 		// Overrides
 		bool canFetchMore ( const QModelIndex & parent ) const;
 		void fetchMore ( const QModelIndex & parent );
@@ -73,13 +95,28 @@ namespace Oln
 		bool dropMimeData ( const QMimeData *, Qt::DropAction, int row, int column, const QModelIndex & );
 	protected slots:
 		void onDbUpdate( Udb::UpdateInfo );
+		void onIdleFetch();
+		void onEvict();
+		void onPersistExpanded();
+		void onLinksChanged();
+	signals:
+		void outlineAboutToChange(); // vor dem Reset durch setOutline, auch bei DbClosing
 	private:
 		Udb::Obj d_outline;
 		class UdbSlot : public Slot
 		{
 		public:
 			Udb::Obj d_item;
+			enum Flag { FlagsValid = 1, FlagTitle = 2, FlagExpanded = 4, FlagReadOnly = 8, FlagAlias = 16 };
+			mutable quint8 d_flags;
+			enum Cursor { CursorUnknown, CursorAt, CursorEnd };
+			mutable quint8 d_cursor;
+			mutable Udb::Obj d_next; // nchstes noch nicht geladenes Item, falls CursorAt
 
+			UdbSlot():d_flags(0),d_cursor(CursorUnknown) {}
+			void resetCursor() { d_cursor = CursorUnknown; d_next = Udb::Obj(); }
+			void loadFlags() const; // liest alle Flags in einem Durchgang aus d_item
+			bool testFlag( const OutlineMdl*, Flag ) const;
 			UdbSlot* getSuper() const { return static_cast<UdbSlot*>( Slot::getSuper() ); }
 			virtual quint64 getId() const;
 			virtual bool isTitle(const OutlineMdl*) const;
@@ -87,6 +124,8 @@ namespace Oln
 			virtual bool isReadOnly(const OutlineMdl*) const;
 			virtual bool isAlias(const OutlineMdl*) const;
 			virtual QVariant getData(const OutlineMdl*,int role) const;
+			virtual void fillRowData(const OutlineMdl*, RowData&, int parts ) const;
+			virtual void subsCleared() { resetCursor(); }
 		};
 		UdbSlot* getSlot( const QModelIndex& index ) const;
 		UdbSlot* findSlot( quint64 id ) const;
@@ -94,7 +133,32 @@ namespace Oln
 		typedef QList<Udb::Obj> ObjList;
 		int fetch( UdbSlot*, int max = 20, ObjList* = 0 ) const; // max=0..all
 		void create( UdbSlot*, const ObjList& );
+		void seek( UdbSlot* ) const; // positioniert den Cursor nach dem letzten geladenen Sub
+		void invalidateCursor( quint64 parent );
+		bool isNextToLoad( UdbSlot*, quint64 oid ) const;
+		void dropUnloadedExpanded();
+		void updateAliases( quint64 target );
+		void scheduleFetch( const QModelIndex& parent );
+		void handleUpdate( const Udb::UpdateInfo& );
+		bool isRelevant( const Udb::UpdateInfo& ) const;
+		void flushBatch();
+		void insertRun( quint64 parent, quint64 before, const QList<quint64>& );
+		void removeRun( quint64 parent, const QList<quint64>& );
+		void moveRun( const QList<Udb::UpdateInfo>& rem, const QList<Udb::UpdateInfo>& ins );
+		int nextRelevant( const QList<Udb::UpdateInfo>&, int from ) const;
 		bool d_blocked;
+		mutable quint32 d_flagHits;
+		mutable quint32 d_flagMisses;
+		QList<quint64> d_pendingFetch; // Parents, deren Level im Leerlauf nachgeladen werden
+		QTimer d_fetchTimer;
+		QTimer d_evictTimer;
+		int d_batch; // adaptive Batch-Grsse
+		QList<Udb::UpdateInfo> d_batched;
+		int d_batchDepth;
+		QHash<quint64,bool> d_expanded; // OID -> offen in diesem View, bersteuert AttrIsExpanded
+		QHash<quint64,bool> d_unsaved; // noch nicht in AttrIsExpanded geschrieben
+		QTimer d_persistTimer;
+		mutable QMultiHash<quint64,quint64> d_aliasTargets; // Ziel -> Alias, fr die fillRowData lief
 	};
 }
 
@@ -40,12 +40,18 @@ static QString _formatTitle(const Udb::Obj & o )
 }
 
 QString (*RefByItemMdl::formatTitle)(const Udb::Obj & o ) = _formatTitle;
+static const int s_pageSize = 200;
 
-RefByItemMdl::RefByItemMdl( QTreeView* p ):QAbstractItemModel( p )
+RefByItemMdl::RefByItemMdl( QTreeView* p ):QAbstractItemModel( p ),d_refs(0)
 {
 	connect( p, SIGNAL( doubleClicked ( const QModelIndex & ) ), this, SLOT( onRefDblClicked( const QModelIndex & ) ) );
 }
 
+RefByItemMdl::~RefByItemMdl()
+{
+	delete d_refs;
+}
+
 QTreeView* RefByItemMdl::getTree() const
 {
 	return static_cast<QTreeView*>( QObject::parent() );
@@ -69,48 +75,79 @@ void RefByItemMdl::refill()
 	foreach( Slot* s, d_root.d_children )
 		delete s;
 	d_root.d_children.clear();
+	d_cache.clear();
+	delete d_refs;
+	d_refs = 0;
 	reset();
 	if( d_root.d_obj.isNull() )
 		return;
-	QMap<Udb::OID,QMap<QString,Udb::OID> > items;
-	Udb::Idx idx( d_root.d_obj.getTxn(), OutlineItem::AliasIndex );
-	if( !idx.isNull() && idx.seek( d_root.d_obj ) ) do
-	{
-		Udb::Obj item = d_root.d_obj.getObject( idx.getOid() );
-		Q_ASSERT( !item.isNull(true,true) && item.getType() == OutlineItem::TID );
-		Udb::Obj context = item.getValueAsObj( OutlineItem::AttrHome );
-		Q_ASSERT( !context.isNull(true,true) );
-		items[context.getOid()][OutlineItem::getParagraphNumber(item)] = item.getOid();
-	}while( idx.nextKey() );
-	QList<OutlineItem> refs = OutlineItem::getReferences( d_root.d_obj );
+	// Nur die erste Seite sofort; den Rest holt die View ueber fetchMore
+	d_refs = new ReferenceCursor( d_root.d_obj, true );
+	addRefs( d_refs->fetch( s_pageSize ), false );
+	reset();
+}
+
+void RefByItemMdl::addRefs( const QList<OutlineItem>& refs, bool notify )
+{
+	// Die Kinder sind sortiert; mit binaerer Suche kostet jede Referenz nur log n
+	QList<Slot*> added;
 	for( int k = 0; k < refs.size(); k++ )
 	{
 		//qDebug() << refs[k].isNull() << refs[k].getOid() << refs[k].getType() << refs[k].getText();
 		Q_ASSERT( !refs[k].isNull(true,true) && refs[k].getType() == OutlineItem::TID  );
 		Udb::Obj context = refs[k].getValueAsObj( OutlineItem::AttrHome );
 		Q_ASSERT( !context.isNull(true,true) );
-		items[context.getOid()][OutlineItem::getParagraphNumber(refs[k])] = refs[k].getOid();
-	}
-	QMap<Udb::OID,QMap<QString,Udb::OID> >::const_iterator i;
-	for( i = items.begin(); i != items.end(); ++i )
-	{
-		Slot* s1 = new Slot();
-		s1->d_parent = &d_root;
-		d_root.d_children.prepend( s1 ); // sortiere absteigend nach OID
-		s1->d_obj = d_root.d_obj.getObject(i.key());
-		d_cache[ i.key() ] = s1;
-		QMap<QString,Udb::OID>::const_iterator j;
-		for( j = i.value().begin(); j != i.value().end(); ++j )
+		Slot* s1 = d_cache.value( context.getOid() );
+		int row1;
+		if( s1 == 0 || s1->d_parent != &d_root )
 		{
-			Slot* s2 = new Slot();
-			s2->d_parent = s1;
-			s1->d_children.append( s2 );
-			s2->d_obj = d_root.d_obj.getObject( j.value() );
-			s2->d_nr = j.key();
-			d_cache[ j.value() ] = s2;
-		}
+			s1 = new Slot();
+			s1->d_obj = context;
+			// sortiere absteigend nach OID
+			row1 = qLowerBound( d_root.d_children.begin(), d_root.d_children.end(), s1, Slot::byOidDesc ) -
+					d_root.d_children.begin();
+			if( notify )
+				beginInsertRows( QModelIndex(), row1, row1 );
+			s1->d_parent = &d_root;
+			d_root.d_children.insert( row1, s1 );
+			d_cache[ context.getOid() ] = s1;
+			if( notify )
+			{
+				endInsertRows();
+				added.append( s1 );
+			}
+		}else
+			row1 = qLowerBound( d_root.d_children.begin(), d_root.d_children.end(), s1, Slot::byOidDesc ) -
+					d_root.d_children.begin();
+		Slot* s2 = new Slot();
+		s2->d_obj = refs[k];
+		s2->d_nr = OutlineItem::getParagraphNumber(refs[k]);
+		// hinter die gleichen Nummern, wie bisher
+		const int row = qUpperBound( s1->d_children.begin(), s1->d_children.end(), s2, Slot::byNr ) -
+				s1->d_children.begin();
+		if( notify )
+			beginInsertRows( createIndex( row1, 0, s1 ), row, row );
+		s2->d_parent = s1;
+		s1->d_children.insert( row, s2 );
+		d_cache[ refs[k].getOid() ] = s2;
+		if( notify )
+			endInsertRows();
 	}
-	reset();
+	// Die erste Seite oeffnet setObj mit expandAll; nachgeladene Kontexte ebenso
+	foreach( Slot* s, added )
+		getTree()->expand( getIndex( s ) );
+}
+
+bool RefByItemMdl::canFetchMore( const QModelIndex & parent ) const
+{
+	return !parent.isValid() && d_refs != 0 && !d_refs->atEnd();
+}
+
+void RefByItemMdl::fetchMore( const QModelIndex & parent )
+{
+	if( !canFetchMore( parent ) )
+		return;
+	addRefs( d_refs->fetch( s_pageSize ), true );
 }
 
 QModelIndex RefByItemMdl::parent ( const QModelIndex & index ) const
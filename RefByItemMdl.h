@@ -29,12 +29,16 @@ class QTreeView;
 
 namespace Oln
 {
+	class OutlineItem;
+	class ReferenceCursor;
+
 	class RefByItemMdl : public QAbstractItemModel
 	{
 		Q_OBJECT
 	public:
 		static QString (*formatTitle)(const Udb::Obj & o );
 		RefByItemMdl( QTreeView* );
+		~RefByItemMdl();
 
 		void setObj( const Udb::Obj&, bool focus = false );
 		void focusOn( const Udb::Obj& );
@@ -50,6 +54,8 @@ namespace Oln
 		QModelIndex index ( int row, int column, const QModelIndex & parent = QModelIndex() ) const;
 		QModelIndex parent ( const QModelIndex & index ) const;
 		int rowCount ( const QModelIndex & parent = QModelIndex() ) const;
+		bool canFetchMore( const QModelIndex & parent ) const;
+		void fetchMore( const QModelIndex & parent );
 	signals:
 		void sigFollowObject(Udb::Obj);
 	protected slots:
@@ -63,13 +69,17 @@ namespace Oln
 			Slot* d_parent;
 			Slot(Slot* p = 0):d_parent(p){ if( p ) p->d_children.append(this); }
 			~Slot() { foreach( Slot* s, d_children ) delete s; }
+			static bool byOidDesc( const Slot* lhs, const Slot* rhs ) { return lhs->d_obj.getOid() > rhs->d_obj.getOid(); }
+			static bool byNr( const Slot* lhs, const Slot* rhs ) { return lhs->d_nr < rhs->d_nr; }
 			void fillSubs();
 		};
 		void fillSubs( Slot* );
+		void addRefs( const QList<OutlineItem>&, bool notify );
 		void recursiveRemove( Slot* s );
 		QModelIndex getIndex( Slot* ) const;
 		QHash<quint32,Slot*> d_cache;
 		Slot d_root;
+		ReferenceCursor* d_refs; // liefert die Referenzen seitenweise
 	};
 }
 
@@ -0,0 +1,124 @@
+/*
+* Copyright 2008-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the CrossLine outliner Oln2 library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include "RowLayoutWorker.h"
+#include <QTextLayout>
+#include <QFontMetricsF>
+#include <QMutexLocker>
+#include <qmath.h>
+using namespace Oln;
+
+RowLayoutWorker::RowLayoutWorker( QObject* p ):QThread( p ),d_stop(false)
+{
+}
+
+RowLayoutWorker::~RowLayoutWorker()
+{
+	d_lock.lock();
+	d_stop = true;
+	d_jobs.clear();
+	d_wait.wakeAll();
+	d_lock.unlock();
+	wait();
+}
+
+void RowLayoutWorker::post( const Job& j )
+{
+	QMutexLocker lock( &d_lock );
+	d_jobs.append( j );
+	if( !isRunning() )
+		start( QThread::LowPriority );
+	else
+		d_wait.wakeOne();
+}
+
+void RowLayoutWorker::clear()
+{
+	QMutexLocker lock( &d_lock );
+	d_jobs.clear();
+}
+
+QList<RowLayoutWorker::Result> RowLayoutWorker::takeResults()
+{
+	QMutexLocker lock( &d_lock );
+	QList<Result> res = d_results;
+	d_results.clear();
+	return res;
+}
+
+QSize RowLayoutWorker::layout( const Job& j )
+{
+	// Entspricht dem Layout von QTextDocument fr einfachen Text; jeder Absatz beginnt mit einer neuen Zeile
+	QString text = j.d_text;
+	text.replace( QLatin1Char( '\n' ), QChar::LineSeparator );
+	QTextLayout l( text, j.d_font );
+	QTextOption opt;
+	opt.setWrapMode( QTextOption::WrapAtWordBoundaryOrAnywhere );
+	l.setTextOption( opt );
+	qreal h = 0.0;
+	bool first = true;
+	l.beginLayout();
+	while( true )
+	{
+		QTextLine line = l.createLine();
+		if( !line.isValid() )
+			break;
+		const qreal indent = ( first ) ? j.d_indent : 0.0;
+		line.setLineWidth( qMax( j.d_textWidth - indent, qreal( 1.0 ) ) );
+		line.setPosition( QPointF( indent, h ) );
+		h += line.height();
+		first = false;
+	}
+	l.endLayout();
+	if( first )
+		h = QFontMetricsF( j.d_font ).height(); // leerer Text hat trotzdem eine Zeile
+	return QSize( j.d_width, qMax( j.d_minHeight, int( qCeil( h + j.d_extra ) ) ) );
+}
+
+void RowLayoutWorker::run()
+{
+	while( true )
+	{
+		d_lock.lock();
+		while( d_jobs.isEmpty() && !d_stop )
+			d_wait.wait( &d_lock );
+		if( d_stop )
+		{
+			d_lock.unlock();
+			return;
+		}
+		const Job j = d_jobs.takeFirst();
+		d_lock.unlock();
+
+		Result r;
+		r.d_oid = j.d_oid;
+		r.d_rev = j.d_rev;
+		r.d_gen = j.d_gen;
+		r.d_depGen = j.d_depGen;
+		r.d_width = j.d_width;
+		r.d_size = layout( j );
+
+		d_lock.lock();
+		const bool notify = d_results.isEmpty(); // Resultate werden gesammelt abgeholt
+		d_results.append( r );
+		d_lock.unlock();
+		if( notify )
+			emit sigResults();
+	}
+}
@@ -0,0 +1,81 @@
+#ifndef __Oln_RowLayoutWorker__
+#define __Oln_RowLayoutWorker__
+
+/*
+* Copyright 2008-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the CrossLine outliner Oln2 library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFont>
+#include <QSize>
+#include <QList>
+
+namespace Oln
+{
+	// Berechnet Zeilenhhen von Outline-Items im Hintergrund. Gearbeitet wird nur mit Kopien
+	// (Text, Font, Breite), darum braucht der Thread weder Modell noch QTextDocument.
+	class RowLayoutWorker : public QThread
+	{
+		Q_OBJECT
+	public:
+		struct Job
+		{
+			quint64 d_oid;
+			quint32 d_rev;
+			quint32 d_gen;
+			quint32 d_depGen; // OutlineMdl::getDependencyGen oder 0
+			int d_width;	// Breite der Row, Schlssel im Cache
+			qreal d_textWidth; // verfgbare Breite fr den Text
+			qreal d_indent; // Einzug der ersten Zeile
+			qreal d_extra;	// Rnder von Dokument und Absatz
+			int d_minHeight;
+			QString d_text; // Plaintext, Abstze mit \n getrennt
+			QFont d_font;
+		};
+		struct Result
+		{
+			quint64 d_oid;
+			quint32 d_rev;
+			quint32 d_gen;
+			quint32 d_depGen;
+			int d_width;
+			QSize d_size; // nur eine Schtzung, da ohne Formate und Links
+		};
+
+		RowLayoutWorker( QObject* );
+		~RowLayoutWorker();
+		void post( const Job& );
+		void clear(); // verwirft alle noch nicht bearbeiteten Jobs
+		QList<Result> takeResults();
+		static QSize layout( const Job& );
+	signals:
+		void sigResults(); // neue Resultate sind abholbereit
+	protected:
+		void run();
+	private:
+		QMutex d_lock;
+		QWaitCondition d_wait;
+		QList<Job> d_jobs;
+		QList<Result> d_results;
+		bool d_stop;
+	};
+}
+
+#endif // __Oln_RowLayoutWorker__
@@ -20,6 +20,7 @@
 #include "TextToOutline.h"
 #include <QTextStream>
 #include <QStack>
+#include <Stream/DataReader.h>
 #include <Txt/TextOutHtml.h>
 #include "OutlineItem.h"
 #include <cassert>
@@ -77,11 +78,11 @@ QList<Udb::Obj> TextToOutline::parse( QString text, Udb::Transaction * txn, Stre
 	return res;
 }
 
-static QString _toText( const Udb::Obj& item, int level )
+static QString _lineText( const Udb::Obj& item, const TextToOutline::PlainTextCache* cache )
 {
-	QString res;
-	for( int i = 0; i < level; i++ )
-		res += QChar('\t');
+	const QString cached = ( cache ) ? cache->getPlainText( item ) : QString();
+	if( !cached.isNull() )
+		return cached.simplified(); // ohne die Bml nochmals zu lesen
 	Stream::DataCell v;
 	Stream::DataCell::OID oid = item.getValue( OutlineItem::AttrAlias ).getOid();
 	if( oid )
@@ -93,20 +94,81 @@ static QString _toText( const Udb::Obj& item, int level )
 			item.getValue( OutlineItem::AttrText, v );
 	}else
 		item.getValue( OutlineItem::AttrText, v );
+	bool complete;
+	const QString text = TextToOutline::toPlainText( v, &complete );
 	if( v.isHtml() )
-		res += Txt::TextOutHtml::htmlToPlainText( v.getStr() );
+		return text;
+	else if( complete )
+		return text.simplified();
 	else
-		res += v.toString().simplified();
+		return v.toString().simplified(); // hier bleiben die Linktexte erhalten
+}
+
+static QString _toText( const Udb::Obj& item, int level, const TextToOutline::PlainTextCache* cache )
+{
+	QString res;
+	for( int i = 0; i < level; i++ )
+		res += QChar('\t');
+	res += _lineText( item, cache );
 	res += QChar('\n');
 	Udb::Obj sub = item.getFirstObj();
 	if( !sub.isNull() ) do
 	{
-		res += _toText( sub, level + 1 );
+		res += _toText( sub, level + 1, cache );
 	}while( sub.next() );
 	return res;
 }
 
-QString TextToOutline::toText( const Udb::Obj &item )
+QString TextToOutline::toText( const Udb::Obj &item, const PlainTextCache* cache )
+{
+	return _toText( item, 0, cache );
+}
+
+QString TextToOutline::toPlainText( const Stream::DataCell& v, bool* complete )
 {
-	return _toText( item, 0 );
+	if( complete )
+		*complete = true;
+	switch( v.getType() )
+	{
+	case Stream::DataCell::TypeAscii:
+	case Stream::DataCell::TypeLatin1:
+	case Stream::DataCell::TypeString:
+		return v.toString();
+	case Stream::DataCell::TypeBml:
+		return bmlToPlainText( v.getBml(), complete );
+	case Stream::DataCell::TypeHtml:
+		return Txt::TextOutHtml::htmlToPlainText( v.getStr() );
+	default:
+		return v.toString();
+	}
+}
+
+QString TextToOutline::bmlToPlainText( const QByteArray& bml, bool* complete )
+{
+	// Ein Durchgang: Strings sammeln wie DataReader::extractString und dabei Links erkennen
+	if( complete )
+		*complete = true;
+	QString res;
+	Stream::DataReader in( bml );
+	Stream::DataReader::Token t = in.nextToken();
+	while( Stream::DataReader::isUseful( t ) )
+	{
+		if( t == Stream::DataReader::Slot )
+		{
+			if( complete && in.getName().getTag().equals( "link" ) )
+				*complete = false;
+			switch( in.getValue().getType() )
+			{
+			case Stream::DataCell::TypeAscii:
+			case Stream::DataCell::TypeLatin1:
+			case Stream::DataCell::TypeString:
+				res += in.getValue().toString();
+				break;
+			default:
+				break;
+			}
+		}
+		t = in.nextToken();
+	}
+	return res;
 }
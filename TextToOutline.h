@@ -28,7 +28,17 @@ namespace Oln
 	{
 	public:
 		static QList<Udb::Obj> parse( QString text, Udb::Transaction*, Stream::DataCell::OID home = 0 ); // return: empty bei fehler
-		static QString toText( const Udb::Obj& item );
+		// Liefert den Plaintext eines Items wie toPlainText, falls schon bekannt und vollstaendig; sonst null
+		struct PlainTextCache
+		{
+			virtual QString getPlainText( const Udb::Obj& item ) const = 0;
+			virtual ~PlainTextCache() {}
+		};
+		static QString toText( const Udb::Obj& item, const PlainTextCache* = 0 );
+		// Plaintext ohne Umweg ueber QTextDocument. complete=false, wenn die Bml Links enthaelt,
+		// deren Text erst ein LinkRenderer ergibt.
+		static QString toPlainText( const Stream::DataCell&, bool* complete = 0 );
+		static QString bmlToPlainText( const QByteArray&, bool* complete = 0 );
 	};
 }
 
@@ -0,0 +1,253 @@
+/*
+* Copyright 2008-2017 Rochus Keller <mailto:me@rochus-keller.info>
+*
+* This file is part of the CrossLine outliner Oln2 library.
+*
+* The following is the license that applies to this copy of the
+* library. For a license to use the library under conditions
+* other than those described here, please email to me@rochus-keller.info.
+*
+* GNU General Public License Usage
+* This file may be used under the terms of the GNU General Public
+* License (GPL) versions 2.0 or 3.0 as published by the Free Software
+* Foundation and appearing in the file LICENSE.GPL included in
+* the packaging of this file. Please review the following information
+* to ensure GNU General Public Licensing requirements will be met:
+* http://www.fsf.org/licensing/licenses/info/GPLv2.html and
+* http://www.gnu.org/copyleft/gpl.html.
+*/
+
+#include <Oln2/OutlineMdl.h>
+#include <Oln2/OutlineTree.h>
+#include <QtTest>
+#include <QMap>
+using namespace Oln;
+
+// Modell ohne Datenbank; die Slots tragen nur ihre OID
+class BenchMdl : public OutlineMdl
+{
+public:
+	class BenchSlot : public Slot
+	{
+	public:
+		quint64 d_id;
+		BenchSlot():d_id(0) {}
+		quint64 getId() const { return d_id; }
+		bool isExpanded(const OutlineMdl*) const { return true; }
+	};
+	BenchMdl():OutlineMdl(0)
+	{
+		setSlotSize( sizeof(BenchSlot) );
+		add( createSlot<BenchSlot>(), 0 );
+	}
+	Slot* append( Slot* to, quint64 id, int before = -1 )
+	{
+		BenchSlot* s = createSlot<BenchSlot>();
+		s->d_id = id;
+		add( s, to, before );
+		return s;
+	}
+	using OutlineMdl::Slot;
+	using OutlineMdl::getRoot;
+	using OutlineMdl::findSlot;
+	using OutlineMdl::remove;
+};
+
+class BenchTree : public OutlineTree
+{
+public:
+	BenchTree():OutlineTree(0) {}
+	using OutlineTree::viewIndex;
+};
+
+class OlnBench : public QObject
+{
+	Q_OBJECT
+private slots:
+	void indexVsMap();
+	void lookup500k();
+	void lookup500kMap();
+	void parentFlat100k();
+	void getIndexFlat100k();
+	void viewIndex200k();
+	void viewIndexToggle200k();
+};
+
+static const int s_lookupItems = 500000;
+static const quint64 s_highOid = Q_UINT64_C(1) << 32; // die Haelfte der OIDs liegt darueber
+
+static quint64 _lookupOid( int i )
+{
+	// Abwechselnd unter- und oberhalb 2^32, mit gleichen unteren 32 Bit wie frueher bei quint32
+	return ( i % 2 ) ? s_highOid + i / 2 + 1 : i / 2 + 1;
+}
+
+static int _lookupOrder( int i, int n )
+{
+	// Zugriff in gestreuter Reihenfolge statt in Einfuegereihenfolge
+	return int( ( qint64(i) * 7919 ) % n );
+}
+
+void OlnBench::indexVsMap()
+{
+	// Zufaelliges Einfuegen und Entfernen, SlotIndex muss immer mit QMap uebereinstimmen
+	BenchMdl mdl;
+	QMap<quint64,BenchMdl::Slot*> ref;
+	// Auf viele kleine Parents verteilt, damit remove nicht jedesmal lange Listen umnumeriert
+	QList<BenchMdl::Slot*> parents;
+	for( int i = 0; i < 256; i++ )
+		parents.append( mdl.append( mdl.getRoot(), ( Q_UINT64_C(1) << 40 ) + i ) );
+	qsrand( 4711 );
+	for( int i = 0; i < 200000; i++ )
+	{
+		const quint64 id = ( ( qrand() % 2 ) ? s_highOid : 0 ) + quint64( qrand() % 50000 ) + 1;
+		if( ref.contains( id ) )
+		{
+			mdl.remove( ref.take( id ) );
+			QVERIFY( mdl.findSlot( id ) == 0 );
+		}else
+			ref.insert( id, mdl.append( parents[ id % parents.size() ], id ) );
+		const quint64 probe = ( ( qrand() % 2 ) ? s_highOid : 0 ) + quint64( qrand() % 50000 ) + 1;
+		QVERIFY( mdl.findSlot( probe ) == ref.value( probe ) );
+	}
+	QMap<quint64,BenchMdl::Slot*>::const_iterator j;
+	for( j = ref.begin(); j != ref.end(); ++j )
+		QVERIFY( mdl.findSlot( j.key() ) == j.value() );
+}
+
+void OlnBench::lookup500k()
+{
+	BenchMdl mdl;
+	for( int i = 0; i < s_lookupItems; i++ )
+		mdl.append( mdl.getRoot(), _lookupOid( i ) );
+	QCOMPARE( mdl.getSlotCount(), s_lookupItems + 1 );
+	int found = 0;
+	QBENCHMARK
+	{
+		found = 0;
+		for( int i = 0; i < s_lookupItems; i++ )
+			if( mdl.findSlot( _lookupOid( _lookupOrder( i, s_lookupItems ) ) ) != 0 )
+				found++;
+	}
+	QCOMPARE( found, s_lookupItems );
+}
+
+void OlnBench::lookup500kMap()
+{
+	// Vergleichswert mit dem frueheren Verfahren (Baum mit O(log n))
+	BenchMdl mdl;
+	QMap<quint64,BenchMdl::Slot*> map;
+	for( int i = 0; i < s_lookupItems; i++ )
+	{
+		const quint64 id = _lookupOid( i );
+		map.insert( id, mdl.append( mdl.getRoot(), id ) );
+	}
+	int found = 0;
+	QBENCHMARK
+	{
+		found = 0;
+		for( int i = 0; i < s_lookupItems; i++ )
+			if( map.value( _lookupOid( _lookupOrder( i, s_lookupItems ) ) ) != 0 )
+				found++;
+	}
+	QCOMPARE( found, s_lookupItems );
+}
+
+static const int s_flatItems = 100000;
+
+void OlnBench::parentFlat100k()
+{
+	// 100k Geschwister mit je einem Sub; parent() des Subs braucht die Row des Geschwisters
+	BenchMdl mdl;
+	QList<QModelIndex> subs;
+	for( int i = 0; i < s_flatItems; i++ )
+		mdl.append( mdl.append( mdl.getRoot(), 2 * i + 1 ), 2 * i + 2 );
+	for( int i = 0; i < s_flatItems; i++ )
+		subs.append( mdl.getIndex( 2 * i + 2 ) );
+	qint64 sum = 0;
+	QBENCHMARK
+	{
+		sum = 0;
+		for( int i = 0; i < subs.size(); i++ )
+			sum += mdl.parent( subs[i] ).row();
+	}
+	QCOMPARE( sum, qint64( s_flatItems ) * ( s_flatItems - 1 ) / 2 );
+}
+
+void OlnBench::getIndexFlat100k()
+{
+	// Einfuegen vorne verschiebt alle Rows; sie werden erst beim naechsten Zugriff einmal neu vergeben
+	BenchMdl mdl;
+	for( int i = 0; i < s_flatItems; i++ )
+		mdl.append( mdl.getRoot(), i + 1 );
+	quint64 next = s_flatItems + 1;
+	int inserted = 0;
+	qint64 sum = 0;
+	QBENCHMARK
+	{
+		mdl.append( mdl.getRoot(), next++, 0 );
+		inserted++;
+		sum = 0;
+		for( int i = 0; i < s_flatItems; i++ )
+			sum += mdl.getIndex( i + 1 ).row();
+	}
+	QCOMPARE( mdl.getIndex( 1 ).row(), inserted );
+	QCOMPARE( sum, qint64( s_flatItems ) * ( s_flatItems - 1 ) / 2 + qint64( inserted ) * s_flatItems );
+}
+
+static const int s_viewParents = 2000;
+static const int s_viewSubs = 99; // mit den Parents 200k Zeilen
+
+static void _fillView( BenchMdl& mdl, BenchTree& tree, QList<QModelIndex>& rows )
+{
+	quint64 id = 0;
+	for( int p = 0; p < s_viewParents; p++ )
+	{
+		BenchMdl::Slot* s = mdl.append( mdl.getRoot(), ++id );
+		for( int c = 0; c < s_viewSubs; c++ )
+			mdl.append( s, ++id );
+	}
+	tree.setModel( &mdl );
+	tree.expandAll();
+	for( quint64 i = 1; i <= id; i++ )
+		rows.append( mdl.getIndex( i ) ); // entspricht der Reihenfolge in viewItems
+}
+
+void OlnBench::viewIndex200k()
+{
+	BenchMdl mdl;
+	BenchTree tree;
+	QList<QModelIndex> rows;
+	_fillView( mdl, tree, rows );
+	QCOMPARE( rows.size(), s_viewParents * ( s_viewSubs + 1 ) );
+	QCOMPARE( tree.viewIndex( rows.last() ), rows.size() - 1 );
+	qint64 sum = 0;
+	QBENCHMARK
+	{
+		// Gestreut, damit die Suche nicht vom letzten Treffer profitiert
+		sum = 0;
+		for( int i = 0; i < rows.size(); i++ )
+			sum += tree.viewIndex( rows[ _lookupOrder( i, rows.size() ) ] );
+	}
+	QCOMPARE( sum, qint64( rows.size() ) * ( rows.size() - 1 ) / 2 );
+}
+
+void OlnBench::viewIndexToggle200k()
+{
+	// Zu- und Aufklappen verwirft die Zuordnung; gemessen wird der Neuaufbau beim naechsten Zugriff
+	BenchMdl mdl;
+	BenchTree tree;
+	QList<QModelIndex> rows;
+	_fillView( mdl, tree, rows );
+	const QModelIndex first = rows.first();
+	QBENCHMARK
+	{
+		tree.collapse( first );
+		tree.expand( first );
+		QCOMPARE( tree.viewIndex( rows.last() ), rows.size() - 1 );
+	}
+}
+
+QTEST_MAIN(OlnBench)
+
+#include "OlnBench.moc"